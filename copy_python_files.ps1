@@ -3,4 +3,5 @@ Copy-Item -Path "mockDbGenerator.py" -Destination "$resourceDir\mockDbGenerator.
 Copy-Item -Path "typeWrappers" -Destination "$resourceDir\typeWrappers" -Force -Recurse
 Copy-Item -Path "dataGenerators" -Destination "$resourceDir\dataGenerators" -Force -Recurse
 Copy-Item -Path "structureReader" -Destination "$resourceDir\structureReader" -Force -Recurse
-Copy-Item -Path "data" -Destination "$resourceDir\data" -Force -Recurse
\ No newline at end of file
+Copy-Item -Path "data" -Destination "$resourceDir\data" -Force -Recurse
+Copy-Item -Path "instrumentation" -Destination "$resourceDir\instrumentation" -Force -Recurse
@@ -0,0 +1,126 @@
+from __future__ import annotations
+from collections import Counter
+from collections.abc import Sequence
+from itertools import accumulate
+from typing import Any, Callable, Hashable, Iterator
+import random
+
+
+class InvalidDictionary(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+class ValueDictionary:
+    # the few distinct values of an enum attribute. Rows are drawn as codes into it, and every output format
+    # formats the values only once: rows then reference the formatted text instead of formatting it again
+    values: list[Any]
+    lookup: list[Any]  # the values by code, NULL included
+
+    def __init__(self, values: list[Any], weights: list[float] | None = None):
+        self.values = values
+        self._cum_weights = list(accumulate(weights)) if weights is not None else None
+        # code len(values) is NULL
+        self.lookup = values + [None]
+        self._formatted: dict[Hashable, list[Any]] = {}
+
+    def __len__(self):
+        return len(self.values)
+
+    def codes(self, rng: random.Random, count: int) -> list[int]:
+        return rng.choices(range(len(self.values)), cum_weights=self._cum_weights, k=count)
+
+    @property
+    def null_code(self) -> int:
+        return len(self.values)
+
+    def formatted(self, key: Hashable, format: Callable[[Any], Any]) -> list[Any]:
+        # the values (and NULL) as one output format writes them, indexed by code
+        formatted = self._formatted.get(key)
+        if formatted is None:
+            formatted = self._formatted[key] = [format(value) for value in self.lookup]
+        return formatted
+
+
+class EncodedColumn(Sequence):
+    # generated values of a dictionary attribute. Only the codes are kept, values are looked up when they are
+    # read, so a column costs one small int per row instead of a decoded list next to its codes
+    dictionary: ValueDictionary
+    codes: list[int]
+
+    def __init__(self, dictionary: ValueDictionary, codes: list[int]):
+        self.dictionary = dictionary
+        self.codes = codes
+
+    def __len__(self) -> int:
+        return len(self.codes)
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return EncodedColumn(self.dictionary, self.codes[index])
+        return self.dictionary.lookup[self.codes[index]]
+
+    def __iter__(self) -> Iterator[Any]:
+        return map(self.dictionary.lookup.__getitem__, self.codes)
+
+    def count(self, value: Any) -> int:
+        lookup = self.dictionary.lookup
+        return sum(count for code, count in Counter(self.codes).items() if lookup[code] == value)
+
+    def cells(self, key: Hashable, format: Callable[[Any], Any]) -> list[Any]:
+        return list(map(self.dictionary.formatted(key, format).__getitem__, self.codes))
+
+
+def _read_values_file(path: str) -> tuple[list[str], list[float] | None]:
+    # one value per line, optionally followed by a tab and its weight
+    values: list[str] = []
+    weights: list[float] = []
+    try:
+        with open(path, "r", encoding="utf-8") as f:
+            for line in f:
+                line = line.rstrip("\r\n")
+                if not line:
+                    continue
+                value, _, weight = line.partition("\t")
+                values.append(value)
+                if weight:
+                    weights.append(_weight(weight))
+    except OSError as e:
+        raise InvalidDictionary(f"cannot read values file '{path}': {e.strerror}")
+    if weights and len(weights) != len(values):
+        raise InvalidDictionary(f"values file '{path}' has weights for only some of its values")
+    return values, weights or None
+
+
+def _weight(value: Any) -> float:
+    try:
+        weight = float(value)
+    except (TypeError, ValueError):
+        raise InvalidDictionary(f"weight '{value}' is not a number")
+    if weight < 0:
+        raise InvalidDictionary(f"weight '{value}' is negative")
+    return weight
+
+
+def parse_dictionary(values: Any, values_file: str | None, weights: Any, cast: Callable[[Any], Any]) -> ValueDictionary:
+    # "values": [...] or "values_file": "path", with optional "weights": [...] in the same order
+    if (values is None) == (values_file is None):
+        raise InvalidDictionary("exactly one of 'values' and 'values_file' must be given")
+    file_weights = None
+    if values_file is not None:
+        values, file_weights = _read_values_file(values_file)
+    if not isinstance(values, list) or not values:
+        raise InvalidDictionary("'values' must be a non empty list")
+    if weights is not None:
+        if file_weights is not None:
+            raise InvalidDictionary("weights are given both in the values file and in 'weights'")
+        if not isinstance(weights, list) or len(weights) != len(values):
+            raise InvalidDictionary(f"'weights' must be a list of {len(values)} numbers, one per value")
+        file_weights = [_weight(w) for w in weights]
+    if file_weights is not None and sum(file_weights) <= 0:
+        raise InvalidDictionary("weights must not all be 0")
+    try:
+        typed = [cast(value) for value in values]
+    except (TypeError, ValueError) as e:
+        raise InvalidDictionary(f"value is not valid for the attribute type: {e}")
+    return ValueDictionary(typed, file_weights)
@@ -0,0 +1,150 @@
+from __future__ import annotations
+from bisect import bisect_left
+from itertools import accumulate
+from statistics import NormalDist
+from typing import Any, Callable
+import math
+import random
+
+# zipf ranks up to this many are drawn from an exact cumulative table, larger domains use the
+# continuous approximation of the bounded power law
+ZIPF_TABLE_LIMIT = 1 << 16
+_INV_2_53 = 1.0 / (1 << 53)
+
+
+class InvalidDistribution(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+def _uniforms(rng: random.Random, count: int) -> list[float]:
+    # open interval (0, 1), so that the inverse cdfs never see their infinite ends
+    bits = rng.getrandbits
+    return [(bits(53) + 0.5) * _INV_2_53 for _ in range(count)]
+
+
+class Distribution:
+    # random numbers of one attribute, drawn a chunk at a time: bulk uniforms mapped through
+    # the inverse cdf of the distribution, then clipped to [min, max] and rounded for integers
+    kind: str
+    integer: bool
+    minimum: float | None
+    maximum: float | None
+
+    def __init__(self, kind: str, params: dict[str, float], integer: bool, minimum: float | None, maximum: float | None):
+        self.kind = kind
+        self.integer = integer
+        self.minimum = minimum
+        self.maximum = maximum
+        self._params = params
+        self._zipf_table: list[float] | None = None
+        self._transform = self._make_transform()
+
+    def _make_transform(self) -> Callable[[list[float]], list[float]]:
+        p = self._params
+        match self.kind:
+            case "uniform":
+                low, span = p["low"], p["high"] - p["low"]
+                if self.integer:
+                    # every integer of [low, high] with the same probability
+                    return lambda u: [math.floor(low + x * (span + 1)) for x in u]
+                return lambda u: [low + x * span for x in u]
+            case "normal":
+                inv_cdf = NormalDist(p["mean"], p["stddev"]).inv_cdf
+                return lambda u: list(map(inv_cdf, u))
+            case "lognormal":
+                inv_cdf = NormalDist(p["mu"], p["sigma"]).inv_cdf
+                exp = math.exp
+                # exp overflows past e^709, such values are clipped by max anyway
+                return lambda u: [exp(min(inv_cdf(x), 709.0)) for x in u]
+            case "exponential":
+                mean = p["mean"]
+                log = math.log
+                return lambda u: [-mean * log(x) for x in u]
+            case "zipf":
+                return self._zipf_transform(int(p["n"]), p["s"])
+        raise InvalidDistribution(f"unknown distribution '{self.kind}'")
+
+    def _zipf_transform(self, n: int, s: float) -> Callable[[list[float]], list[float]]:
+        # ranks 1..n with probability proportional to 1 / rank^s
+        if n <= ZIPF_TABLE_LIMIT:
+            if self._zipf_table is None:
+                weights = list(accumulate(rank ** -s for rank in range(1, n + 1)))
+                self._zipf_table = [w / weights[-1] for w in weights]
+                # rounding must not leave uniforms close to 1 past the last rank
+                self._zipf_table[-1] = 1.0
+            table = self._zipf_table
+            return lambda u: [bisect_left(table, x) + 1 for x in u]
+        if s == 1.0:
+            log_n = math.log(n + 1)
+            return lambda u: [min(n, int(math.exp(x * log_n))) for x in u]
+        e = 1.0 - s
+        top = (n + 1) ** e
+        return lambda u: [min(n, int((1.0 + x * (top - 1.0)) ** (1.0 / e))) for x in u]
+
+    def sample(self, rng: random.Random, count: int) -> list[Any]:
+        values = self._transform(_uniforms(rng, count))
+        if self.minimum is not None or self.maximum is not None:
+            low = self.minimum if self.minimum is not None else -math.inf
+            high = self.maximum if self.maximum is not None else math.inf
+            values = [low if v < low else high if v > high else v for v in values]
+        if self.integer:
+            return [int(round(v)) for v in values]
+        return [float(v) for v in values]
+
+
+# parameters of every distribution with their defaults, None means the attribute's step
+_PARAMETERS: dict[str, dict[str, float | None]] = {
+    "uniform": {"low": 0.0, "high": None},
+    "normal": {"mean": 0.0, "stddev": 1.0},
+    "lognormal": {"mu": 0.0, "sigma": 1.0},
+    "exponential": {"mean": 1.0},
+    "zipf": {"s": 1.0, "n": None},
+}
+
+_POSITIVE = {
+    "normal": ("stddev",),
+    "lognormal": ("sigma",),
+    "exponential": ("mean",),
+    "zipf": ("s",),
+}
+
+
+def parse_distribution(spec: Any, integer: bool, step: float) -> Distribution:
+    # {"type": "normal", "mean": 50, "stddev": 10, "min": 0, "max": 100} or just the type
+    if isinstance(spec, str):
+        spec = {"type": spec}
+    if not isinstance(spec, dict) or "type" not in spec:
+        raise InvalidDistribution("distribution must be a type or an object with a 'type'")
+    kind = str(spec["type"]).lower()
+    if kind not in _PARAMETERS:
+        raise InvalidDistribution(f"unknown distribution '{kind}', valid distributions are {', '.join(_PARAMETERS)}")
+    unknown = set(spec) - set(_PARAMETERS[kind]) - {"type", "min", "max"} - ({"rate"} if kind == "exponential" else set())
+    if unknown:
+        raise InvalidDistribution(f"distribution '{kind}' has no parameter(s) {', '.join(sorted(unknown))}")
+
+    def number(key: str, default: float | None) -> float | None:
+        if key not in spec:
+            return default
+        try:
+            return float(spec[key])
+        except (TypeError, ValueError):
+            raise InvalidDistribution(f"parameter '{key}' of distribution '{kind}' is not a number")
+
+    params = {key: number(key, default if default is not None else float(step)) for key, default in _PARAMETERS[kind].items()}
+    if kind == "exponential" and "rate" in spec:
+        rate = number("rate", None)
+        if not rate or rate <= 0:
+            raise InvalidDistribution("rate of an exponential distribution must be positive")
+        params["mean"] = 1.0 / rate
+    for key in _POSITIVE.get(kind, ()):
+        if params[key] <= 0:  # type: ignore
+            raise InvalidDistribution(f"parameter '{key}' of distribution '{kind}' must be positive")
+    if kind == "zipf" and params["n"] < 1:  # type: ignore
+        raise InvalidDistribution("n of a zipf distribution must be at least 1")
+    if kind == "uniform" and params["high"] < params["low"]:  # type: ignore
+        raise InvalidDistribution("high of a uniform distribution is below its low")
+    minimum, maximum = number("min", None), number("max", None)
+    if minimum is not None and maximum is not None and maximum < minimum:
+        raise InvalidDistribution(f"max of distribution '{kind}' is below its min")
+    return Distribution(kind, params, integer, minimum, maximum)  # type: ignore
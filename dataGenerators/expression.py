@@ -0,0 +1,540 @@
+from __future__ import annotations
+from typeWrappers.types import DbType
+from dataGenerators.generators import derive_seed
+from datetime import datetime, timedelta
+from enum import IntEnum
+from itertools import repeat
+from typing import Any, Callable
+import operator
+import random
+import re
+
+
+class ExprType(IntEnum):
+    INTEGER = 1
+    STRING = 2
+    REAL = 3
+    DATE = 4
+    INTERVAL = 5
+    BOOLEAN = 6
+
+
+# longest text str() produces for values of each type
+_TEXT_LENGTH = {
+    ExprType.INTEGER: 20,
+    ExprType.REAL: 24,
+    ExprType.DATE: 26,
+    ExprType.INTERVAL: 32,
+    ExprType.BOOLEAN: 5,
+}
+_NUMBERS = (ExprType.INTEGER, ExprType.REAL)
+
+
+class InvalidExpression(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+class _Context:
+    # inputs of one evaluation: the dependency columns of rows [lo, hi)
+    __slots__ = ("columns", "lo", "hi", "seed", "chunk_rows")
+
+    def __init__(self, columns: dict[str, list[Any]], lo: int, hi: int, seed: int, chunk_rows: int):
+        self.columns = columns
+        self.lo = lo
+        self.hi = hi
+        self.seed = seed
+        self.chunk_rows = chunk_rows
+
+
+class _Node:
+    # a typed node of the compiled tree, either a constant or a function evaluating a whole column
+    type: ExprType
+    max_length: int | None  # only for strings
+    value: Any
+    fn: Callable[[_Context], list[Any]] | None
+
+    def __init__(self, type: ExprType, fn: Callable[[_Context], list[Any]] | None = None, value: Any = None, max_length: int | None = None):
+        self.type = type
+        self.fn = fn
+        self.value = value
+        self.max_length = max_length
+
+    @property
+    def is_const(self) -> bool:
+        return self.fn is None
+
+    def column(self, ctx: _Context) -> Any:
+        # an iterable over the rows, constants are repeated
+        return repeat(self.value) if self.fn is None else self.fn(ctx)
+
+
+def _const(type: ExprType, value: Any) -> _Node:
+    return _Node(type, value=value, max_length=len(value) if type == ExprType.STRING else None)
+
+
+def _apply(type: ExprType, fn: Callable, args: list[_Node], max_length: int | None = None) -> _Node:
+    # applies fn row by row, folding it when all the arguments are constants
+    if all(arg.is_const for arg in args):
+        node = _const(type, fn(*(arg.value for arg in args)))
+        if max_length is not None and type == ExprType.STRING:
+            node.max_length = len(node.value)
+        return node
+    if len(args) == 1:
+        inner = args[0].fn
+        return _Node(type, lambda ctx: list(map(fn, inner(ctx))), max_length=max_length)  # type: ignore
+    return _Node(type, lambda ctx: list(map(fn, *(arg.column(ctx) for arg in args))), max_length=max_length)
+
+
+def _add_length(*nodes: _Node) -> int:
+    return sum(node.max_length if node.max_length is not None else _TEXT_LENGTH[node.type] for node in nodes)
+
+
+def _common_type(name: str, nodes: list[_Node]) -> ExprType:
+    types = {node.type for node in nodes}
+    if len(types) == 1:
+        return nodes[0].type
+    if types <= set(_NUMBERS):
+        return ExprType.REAL
+    raise InvalidExpression(f"{name} cannot mix {', '.join(t.name for t in types)}")
+
+
+def _to_real(node: _Node) -> _Node:
+    return _apply(ExprType.REAL, float, [node]) if node.type == ExprType.INTEGER else node
+
+
+_BINARY_RULES: dict[str, list[tuple[ExprType, ExprType, ExprType]]] = {
+    "+": [
+        (ExprType.INTEGER, ExprType.INTEGER, ExprType.INTEGER),
+        (ExprType.STRING, ExprType.STRING, ExprType.STRING),
+        (ExprType.DATE, ExprType.INTERVAL, ExprType.DATE),
+        (ExprType.INTERVAL, ExprType.DATE, ExprType.DATE),
+        (ExprType.INTERVAL, ExprType.INTERVAL, ExprType.INTERVAL),
+    ],
+    "-": [
+        (ExprType.INTEGER, ExprType.INTEGER, ExprType.INTEGER),
+        (ExprType.DATE, ExprType.INTERVAL, ExprType.DATE),
+        (ExprType.DATE, ExprType.DATE, ExprType.INTERVAL),
+        (ExprType.INTERVAL, ExprType.INTERVAL, ExprType.INTERVAL),
+    ],
+    "*": [
+        (ExprType.INTEGER, ExprType.INTEGER, ExprType.INTEGER),
+        (ExprType.INTERVAL, ExprType.INTEGER, ExprType.INTERVAL),
+        (ExprType.INTERVAL, ExprType.REAL, ExprType.INTERVAL),
+        (ExprType.INTEGER, ExprType.INTERVAL, ExprType.INTERVAL),
+        (ExprType.REAL, ExprType.INTERVAL, ExprType.INTERVAL),
+    ],
+    "/": [],
+    "//": [(ExprType.INTEGER, ExprType.INTEGER, ExprType.INTEGER)],
+    "%": [(ExprType.INTEGER, ExprType.INTEGER, ExprType.INTEGER)],
+}
+_BINARY_OPERATORS = {
+    "+": operator.add,
+    "-": operator.sub,
+    "*": operator.mul,
+    "/": operator.truediv,
+    "//": operator.floordiv,
+    "%": operator.mod,
+}
+_COMPARISONS = {
+    "<": operator.lt,
+    "<=": operator.le,
+    ">": operator.gt,
+    ">=": operator.ge,
+    "==": operator.eq,
+    "=": operator.eq,
+    "!=": operator.ne,
+    "<>": operator.ne,
+}
+
+
+def _binary(op: str, left: _Node, right: _Node) -> _Node:
+    for left_type, right_type, result in _BINARY_RULES[op]:
+        if left.type == left_type and right.type == right_type:
+            max_length = _add_length(left, right) if result == ExprType.STRING else None
+            return _apply(result, _BINARY_OPERATORS[op], [left, right], max_length)
+    if left.type in _NUMBERS and right.type in _NUMBERS:
+        # mixed numbers and true division are real
+        return _apply(ExprType.REAL, _BINARY_OPERATORS[op], [_to_real(left), _to_real(right)])
+    raise InvalidExpression(f"operator '{op}' cannot be applied to {left.type.name} and {right.type.name}")
+
+
+def _compare(op: str, left: _Node, right: _Node) -> _Node:
+    if left.type != right.type and not (left.type in _NUMBERS and right.type in _NUMBERS):
+        raise InvalidExpression(f"cannot compare {left.type.name} with {right.type.name}")
+    return _apply(ExprType.BOOLEAN, _COMPARISONS[op], [left, right])
+
+
+def _if(cond: bool, a: Any, b: Any) -> Any:
+    return a if cond else b
+
+
+def _substr(text: str, start: int, length: int) -> str:
+    # 1 based like SQL
+    return text[max(start - 1, 0):max(start - 1, 0) + max(length, 0)]
+
+
+def _to_text(node: _Node) -> _Node:
+    if node.type == ExprType.STRING:
+        return node
+    return _apply(ExprType.STRING, str, [node], _TEXT_LENGTH[node.type])
+
+
+def _interval(unit: str) -> Callable[[list[_Node]], _Node]:
+    def make(args: list[_Node]) -> _Node:
+        _check_arity(unit, args, 1)
+        _check_types(unit, args, _NUMBERS)
+        return _apply(ExprType.INTERVAL, lambda n: timedelta(**{unit: n}), args)
+    return make
+
+
+def _check_arity(name: str, args: list[_Node], low: int, high: int | None = None):
+    high = low if high is None else high
+    if not low <= len(args) <= high:
+        expected = f"{low}" if low == high else f"{low} to {high}"
+        raise InvalidExpression(f"{name}() takes {expected} arguments but {len(args)} were given")
+
+
+def _check_types(name: str, args: list[_Node], types: tuple[ExprType, ...]):
+    for arg in args:
+        if arg.type not in types:
+            raise InvalidExpression(f"{name}() does not accept {arg.type.name} arguments")
+
+
+def _fn_abs(args: list[_Node]) -> _Node:
+    _check_arity("abs", args, 1)
+    if args[0].type == ExprType.INTERVAL:
+        return _apply(ExprType.INTERVAL, abs, args)
+    _check_types("abs", args, _NUMBERS)
+    return _apply(args[0].type, abs, args)
+
+
+def _fn_extreme(name: str, fn: Callable) -> Callable[[list[_Node]], _Node]:
+    def make(args: list[_Node]) -> _Node:
+        _check_arity(name, args, 2, 64)
+        type = _common_type(f"{name}()", args)
+        if type == ExprType.BOOLEAN:
+            raise InvalidExpression(f"{name}() does not accept BOOLEAN arguments")
+        if type == ExprType.REAL:
+            args = [_to_real(arg) for arg in args]
+        max_length = max(arg.max_length or 0 for arg in args) if type == ExprType.STRING else None
+        return _apply(type, lambda *values: fn(values), args, max_length)
+    return make
+
+
+def _fn_round(args: list[_Node]) -> _Node:
+    _check_arity("round", args, 1, 2)
+    _check_types("round", args[:1], _NUMBERS)
+    if len(args) == 1:
+        return _apply(ExprType.INTEGER, round, args)
+    _check_types("round", args[1:], (ExprType.INTEGER,))
+    return _apply(ExprType.REAL, round, [_to_real(args[0]), args[1]])
+
+
+def _fn_int(args: list[_Node]) -> _Node:
+    _check_arity("int", args, 1)
+    _check_types("int", args, (ExprType.INTEGER, ExprType.REAL, ExprType.STRING, ExprType.BOOLEAN))
+    return _apply(ExprType.INTEGER, int, args)
+
+
+def _fn_real(args: list[_Node]) -> _Node:
+    _check_arity("real", args, 1)
+    _check_types("real", args, (ExprType.INTEGER, ExprType.REAL, ExprType.STRING))
+    return _apply(ExprType.REAL, float, args)
+
+
+def _fn_str(args: list[_Node]) -> _Node:
+    _check_arity("str", args, 1)
+    return _to_text(args[0])
+
+
+def _fn_case(name: str, fn: Callable) -> Callable[[list[_Node]], _Node]:
+    def make(args: list[_Node]) -> _Node:
+        _check_arity(name, args, 1)
+        _check_types(name, args, (ExprType.STRING,))
+        return _apply(ExprType.STRING, fn, args, args[0].max_length)
+    return make
+
+
+def _fn_length(args: list[_Node]) -> _Node:
+    _check_arity("length", args, 1)
+    _check_types("length", args, (ExprType.STRING,))
+    return _apply(ExprType.INTEGER, len, args)
+
+
+def _fn_substr(args: list[_Node]) -> _Node:
+    _check_arity("substr", args, 3)
+    _check_types("substr", args[:1], (ExprType.STRING,))
+    _check_types("substr", args[1:], (ExprType.INTEGER,))
+    max_length = args[0].max_length
+    if args[2].is_const and max_length is not None:
+        max_length = min(max_length, max(args[2].value, 0))
+    return _apply(ExprType.STRING, _substr, args, max_length)
+
+
+def _fn_concat(args: list[_Node]) -> _Node:
+    _check_arity("concat", args, 1, 64)
+    texts = [_to_text(arg) for arg in args]
+    return _apply(ExprType.STRING, lambda *values: "".join(values), texts, _add_length(*texts))
+
+
+def _fn_if(args: list[_Node]) -> _Node:
+    _check_arity("if", args, 3)
+    _check_types("if", args[:1], (ExprType.BOOLEAN,))
+    type = _common_type("if()", args[1:])
+    branches = [_to_real(arg) for arg in args[1:]] if type == ExprType.REAL else args[1:]
+    max_length = max(arg.max_length or 0 for arg in branches) if type == ExprType.STRING else None
+    return _apply(type, _if, [args[0], *branches], max_length)
+
+
+def _fn_date(args: list[_Node]) -> _Node:
+    _check_arity("date", args, 1)
+    if not args[0].is_const or args[0].type != ExprType.STRING:
+        raise InvalidExpression("date() takes a constant string")
+    try:
+        return _const(ExprType.DATE, datetime.fromisoformat(args[0].value))
+    except ValueError:
+        raise InvalidExpression(f"'{args[0].value}' is not a valid date")
+
+
+def _fn_date_part(name: str) -> Callable[[list[_Node]], _Node]:
+    def make(args: list[_Node]) -> _Node:
+        _check_arity(name, args, 1)
+        _check_types(name, args, (ExprType.DATE,))
+        return _apply(ExprType.INTEGER, operator.attrgetter(name), args)
+    return make
+
+
+_FUNCTIONS: dict[str, Callable[[list[_Node]], _Node]] = {
+    "abs": _fn_abs,
+    "min": _fn_extreme("min", min),
+    "max": _fn_extreme("max", max),
+    "round": _fn_round,
+    "int": _fn_int,
+    "real": _fn_real,
+    "str": _fn_str,
+    "lower": _fn_case("lower", str.lower),
+    "upper": _fn_case("upper", str.upper),
+    "length": _fn_length,
+    "substr": _fn_substr,
+    "concat": _fn_concat,
+    "if": _fn_if,
+    "date": _fn_date,
+    "year": _fn_date_part("year"),
+    "month": _fn_date_part("month"),
+    "day": _fn_date_part("day"),
+    "weeks": _interval("weeks"),
+    "days": _interval("days"),
+    "hours": _interval("hours"),
+    "minutes": _interval("minutes"),
+    "seconds": _interval("seconds"),
+}
+
+_TOKEN = re.compile(r"""
+    \s*(?:
+        (?P<number>\d+\.\d*(?:[eE][-+]?\d+)?|\.\d+(?:[eE][-+]?\d+)?|\d+[eE][-+]?\d+|\d+)
+        |'(?P<string>[^']*)'
+        |(?P<name>[A-Za-z_][A-Za-z_0-9]*)
+        |(?P<op>//|<=|>=|==|!=|<>|[-+*/%(),<>=])
+    )""", re.VERBOSE)
+
+
+def _tokenize(text: str) -> list[tuple[str, str]]:
+    tokens = []
+    position = 0
+    text = text.rstrip()
+    while position < len(text):
+        match = _TOKEN.match(text, position)
+        if match is None:
+            raise InvalidExpression(f"unexpected character '{text[position:].lstrip()[:1]}' at position {position}")
+        kind = match.lastgroup
+        tokens.append((kind, match.group(kind)))  # type: ignore
+        position = match.end()
+    tokens.append(("end", ""))
+    return tokens
+
+
+class CompiledExpression:
+    # an expression parsed once into a typed tree of closures, each evaluating a whole column at a time
+    text: str
+    type: ExprType
+    max_length: int | None
+    dependencies: list[str]
+
+    def __init__(self, text: str, target: DbType, columns: dict[str, tuple[DbType, int | None]]):
+        # columns maps the names which can be referenced to their type and maximum string length
+        self.text = text
+        self.dependencies = []
+        self._columns = columns
+        self._random_nodes = 0
+        self._tokens = _tokenize(text)
+        self._position = 0
+        node = self._parse_or()
+        if self._peek() != ("end", ""):
+            raise InvalidExpression(f"unexpected '{self._peek()[1]}' in expression '{text}'")
+        target_type = ExprType(int(target))
+        if node.type == ExprType.INTEGER and target_type == ExprType.REAL:
+            node = _to_real(node)
+        if node.type != target_type:
+            raise InvalidExpression(f"expression '{text}' is {node.type.name} but the attribute is {target_type.name}")
+        self.type = node.type
+        self.max_length = node.max_length
+        self._root = node
+        del self._tokens
+
+    @staticmethod
+    def referenced_names(text: str) -> set[str]:
+        # names of the attributes an expression uses, known before it can be compiled
+        tokens = _tokenize(text)
+        return {
+            value for (kind, value), following in zip(tokens, tokens[1:])
+            if kind == "name" and value.lower() not in ("and", "or", "not", "true", "false") and following != ("op", "(")
+        }
+
+    def evaluate(self, columns: dict[str, list[Any]], lo: int, hi: int, seed: int, chunk_rows: int) -> list[Any]:
+        ctx = _Context(columns, lo, hi, seed, chunk_rows)
+        try:
+            if self._root.is_const:
+                return [self._root.value] * (hi - lo)
+            return self._root.fn(ctx)  # type: ignore
+        except (ArithmeticError, ValueError) as exc:
+            raise ValueError(f"Expression '{self.text}' failed: {exc}")
+
+    def _peek(self) -> tuple[str, str]:
+        return self._tokens[self._position]
+
+    def _next(self) -> tuple[str, str]:
+        token = self._tokens[self._position]
+        self._position += 1
+        return token
+
+    def _accept(self, *values: str) -> str | None:
+        kind, value = self._peek()
+        if kind in ("op", "name") and value.lower() in values:
+            self._position += 1
+            return value.lower()
+        return None
+
+    def _expect(self, value: str):
+        if self._accept(value) is None:
+            raise InvalidExpression(f"expected '{value}' but found '{self._peek()[1] or 'end of expression'}' in '{self.text}'")
+
+    def _parse_or(self) -> _Node:
+        node = self._parse_and()
+        while self._accept("or"):
+            right = self._parse_and()
+            _check_types("or", [node, right], (ExprType.BOOLEAN,))
+            node = _apply(ExprType.BOOLEAN, lambda a, b: a or b, [node, right])
+        return node
+
+    def _parse_and(self) -> _Node:
+        node = self._parse_not()
+        while self._accept("and"):
+            right = self._parse_not()
+            _check_types("and", [node, right], (ExprType.BOOLEAN,))
+            node = _apply(ExprType.BOOLEAN, lambda a, b: a and b, [node, right])
+        return node
+
+    def _parse_not(self) -> _Node:
+        if self._accept("not"):
+            node = self._parse_not()
+            _check_types("not", [node], (ExprType.BOOLEAN,))
+            return _apply(ExprType.BOOLEAN, operator.not_, [node])
+        return self._parse_comparison()
+
+    def _parse_comparison(self) -> _Node:
+        node = self._parse_sum()
+        if op := self._accept(*_COMPARISONS):
+            node = _compare(op, node, self._parse_sum())
+        return node
+
+    def _parse_sum(self) -> _Node:
+        node = self._parse_product()
+        while op := self._accept("+", "-"):
+            node = _binary(op, node, self._parse_product())
+        return node
+
+    def _parse_product(self) -> _Node:
+        node = self._parse_unary()
+        while op := self._accept("*", "/", "//", "%"):
+            node = _binary(op, node, self._parse_unary())
+        return node
+
+    def _parse_unary(self) -> _Node:
+        if self._accept("-"):
+            node = self._parse_unary()
+            if node.type not in (*_NUMBERS, ExprType.INTERVAL):
+                raise InvalidExpression(f"cannot negate {node.type.name}")
+            return _apply(node.type, operator.neg, [node])
+        return self._parse_primary()
+
+    def _parse_primary(self) -> _Node:
+        kind, value = self._next()
+        if kind == "number":
+            return _const(ExprType.REAL, float(value)) if any(c in value for c in ".eE") else _const(ExprType.INTEGER, int(value))
+        if kind == "string":
+            return _const(ExprType.STRING, value)
+        if kind == "op" and value == "(":
+            node = self._parse_or()
+            self._expect(")")
+            return node
+        if kind != "name":
+            raise InvalidExpression(f"unexpected '{value or 'end of expression'}' in '{self.text}'")
+        lowered = value.lower()
+        if lowered in ("true", "false"):
+            return _const(ExprType.BOOLEAN, lowered == "true")
+        if self._accept("("):
+            args = []
+            if not self._accept(")"):
+                args.append(self._parse_or())
+                while self._accept(","):
+                    args.append(self._parse_or())
+                self._expect(")")
+            return self._call(lowered, args)
+        return self._column(value)
+
+    def _column(self, name: str) -> _Node:
+        if name not in self._columns:
+            raise InvalidExpression(f"unknown attribute '{name}' in expression '{self.text}'")
+        db_type, max_length = self._columns[name]
+        if name not in self.dependencies:
+            self.dependencies.append(name)
+        type = ExprType(int(db_type))
+        return _Node(type, lambda ctx: ctx.columns[name], max_length=max_length if type == ExprType.STRING else None)
+
+    def _call(self, name: str, args: list[_Node]) -> _Node:
+        if name == "row":
+            _check_arity("row", args, 0)
+            return _Node(ExprType.INTEGER, lambda ctx: list(range(ctx.lo, ctx.hi)))
+        if name in ("randint", "uniform"):
+            return self._random(name, args)
+        if name not in _FUNCTIONS:
+            raise InvalidExpression(f"unknown function '{name}' in expression '{self.text}'")
+        return _FUNCTIONS[name](args)
+
+    def _random(self, name: str, args: list[_Node]) -> _Node:
+        # every random call has its own stream, drawn per chunk like the generators
+        # so that any row range evaluates to the same values
+        _check_arity(name, args, 2)
+        _check_types(name, args, (ExprType.INTEGER,) if name == "randint" else _NUMBERS)
+        index = self._random_nodes
+        self._random_nodes += 1
+
+        def draws(ctx: _Context) -> list[float]:
+            values = []
+            for chunk in range(ctx.lo // ctx.chunk_rows, (ctx.hi + ctx.chunk_rows - 1) // ctx.chunk_rows):
+                chunk_start = chunk * ctx.chunk_rows
+                chunk_hi = min(ctx.hi, chunk_start + ctx.chunk_rows)
+                rng = random.Random(derive_seed(ctx.seed, "expression", index, chunk))
+                chunk_values = [rng.random() for _ in range(chunk_start, chunk_hi)]
+                values.extend(chunk_values[max(ctx.lo, chunk_start) - chunk_start:])
+            return values
+        uniform = _Node(ExprType.REAL, draws)
+        if name == "randint":
+            return _Node(ExprType.INTEGER, lambda ctx: list(map(
+                lambda u, a, b: a + int(u * (b - a + 1)), draws(ctx), args[0].column(ctx), args[1].column(ctx)
+            )))
+        low, high = _to_real(args[0]), _to_real(args[1])
+        return _Node(ExprType.REAL, lambda ctx: list(map(
+            lambda u, a, b: a + u * (b - a), uniform.column(ctx), low.column(ctx), high.column(ctx)
+        )))
@@ -3,6 +3,9 @@ from typeWrappers.types import DbType
 from datetime import datetime, timedelta
 from typing import Generator
 from enum import IntFlag
+from fractions import Fraction
+import hashlib
+import math
 import random
 import string
 import os
@@ -17,6 +20,10 @@ class GenerationMode(IntFlag):
     EMAIL = 0x20
     PHONE = 0x40
     NATURALTEXT = 0x80
+    # computed from the other attributes of the row, see dataGenerators.expression
+    EXPRESSION = 0x100
+    # drawn from a list of values, see dataGenerators.dictionary
+    ENUM = 0x200
 
 def preload_data(file_name: str) -> list[str]:
     with open(os.path.join('data', file_name), 'r') as file:
@@ -136,33 +143,75 @@ VALID_PATTERNS_PER_TYPE: dict[DbType, GenerationMode] = {
     DbType.INTEGER: GenerationMode.RANDOM
     | GenerationMode.INCREASING
     | GenerationMode.DECREASING
-    | GenerationMode.REPEATING,
+    | GenerationMode.REPEATING
+    | GenerationMode.EXPRESSION
+    | GenerationMode.ENUM,
     DbType.STRING: GenerationMode.RANDOM
     | GenerationMode.REPEATING
     | GenerationMode.NAMESURNAME
     | GenerationMode.EMAIL
     | GenerationMode.PHONE
-    | GenerationMode.NATURALTEXT,
+    | GenerationMode.NATURALTEXT
+    | GenerationMode.EXPRESSION
+    | GenerationMode.ENUM,
     DbType.REAL: GenerationMode.RANDOM
     | GenerationMode.INCREASING
     | GenerationMode.DECREASING
-    | GenerationMode.REPEATING,
+    | GenerationMode.REPEATING
+    | GenerationMode.EXPRESSION
+    | GenerationMode.ENUM,
     DbType.DATE: GenerationMode.RANDOM
     | GenerationMode.INCREASING
-    | GenerationMode.DECREASING,
+    | GenerationMode.DECREASING
+    | GenerationMode.EXPRESSION
+    | GenerationMode.ENUM,
 }
 
 _T_TYPES = str | int | float | bool | datetime
 _PATT_TYPES = str | int | float | bool | timedelta | None
 
 
+def derive_seed(*parts) -> int:
+    # stable across processes and python versions, unlike hash()
+    h = hashlib.blake2b(digest_size=8)
+    for part in parts:
+        h.update(str(part).encode("utf-8"))
+        h.update(b"\0")
+    return int.from_bytes(h.digest(), "little")
+
+
+def repeating_value(starting_value: int | float, index: int, pattern_number: int | float) -> int | float:
+    # value at row `index` of a REPEATING sequence: it counts up from the starting value
+    # and goes back to 0 every time the number of generated values is a multiple of the pattern.
+    # A float is an exact fraction n/d in lowest terms, and an integer count is a multiple of it
+    # exactly when it is a multiple of n, so the sequence is reset every n values (n is the pattern
+    # itself for integers) and the value is the distance from the last reset
+    if not math.isfinite(pattern_number):
+        return starting_value + index
+    pattern = abs(Fraction(pattern_number).numerator)
+    if index < pattern:
+        return starting_value + index
+    return type(starting_value)(index % pattern)
+
+
 class ValueGenerator(metaclass=ABCMeta):
     quantity: int
     generation_mode: GenerationMode
+    generated_values: int
+    rng: random.Random
+    seed: int
 
-    def __init__(self, quantity: int, generation_mode: GenerationMode):
+    def __init__(self, quantity: int, generation_mode: GenerationMode, rng: random.Random | None = None, seed: int | None = None):
         self.quantity = quantity
         self.generation_mode = generation_mode
+        self.generated_values = 0
+        self.rng = rng if rng is not None else random.Random()
+        # seed is stable for the whole attribute, rng may be reseeded for every chunk
+        self.seed = seed if seed is not None else self.rng.getrandbits(64)
+
+    def seek(self, index: int, pattern_number: _PATT_TYPES):
+        # positions the generator so that the next generated value is the one of row `index`
+        self.generated_values = index
 
     @abstractmethod
     def generate(self, pattern_number: _PATT_TYPES) -> Generator[_T_TYPES, None, None]:
@@ -171,21 +220,31 @@ class ValueGenerator(metaclass=ABCMeta):
 
 class GenerateInteger(ValueGenerator):
     current_value: int
-    generated_values: int
+    starting_value: int
 
     def __init__(
-        self, quantity: int, generation_mode: GenerationMode, starting_value: int = 0
+        self, quantity: int, generation_mode: GenerationMode, starting_value: int = 0, rng: random.Random | None = None, seed: int | None = None
     ):
-        self.generated_values = 0
         self.current_value = starting_value
-        super().__init__(quantity, generation_mode)
+        self.starting_value = starting_value
+        super().__init__(quantity, generation_mode, rng, seed)
+
+    def seek(self, index: int, pattern_number: int):
+        super().seek(index, pattern_number)
+        match self.generation_mode:
+            case GenerationMode.INCREASING:
+                self.current_value = self.starting_value + index * pattern_number
+            case GenerationMode.DECREASING:
+                self.current_value = self.starting_value - index * pattern_number
+            case GenerationMode.REPEATING:
+                self.current_value = repeating_value(self.starting_value, index, pattern_number)
 
     def generate(self, pattern_number: int) -> Generator[int, None, None]:
         while self.generated_values < self.quantity:
             self.generated_values += 1
             match self.generation_mode:
                 case GenerationMode.RANDOM:
-                    yield random.randint(0, pattern_number)
+                    yield self.rng.randint(0, pattern_number)
                 case GenerationMode.INCREASING:
                     value = self.current_value
                     self.current_value += pattern_number
@@ -206,55 +265,74 @@ class GenerateInteger(ValueGenerator):
 
 class GenerateString(ValueGenerator):
     repeated_values: list[str]
-    generated_values: int
 
-    def __init__(self, quantity: int, generation_mode: GenerationMode):
+    PHONE_LENGTH = 10
+
+    def __init__(self, quantity: int, generation_mode: GenerationMode, rng: random.Random | None = None, seed: int | None = None):
         self.repeated_values = []
-        self.generated_values = 0
-        super().__init__(quantity, generation_mode)
+        super().__init__(quantity, generation_mode, rng, seed)
+
+    @staticmethod
+    def max_length(generation_mode: GenerationMode, pattern_number: int) -> int:
+        # upper bound of the generated strings, known without generating any data
+        match generation_mode:
+            case GenerationMode.NAMESURNAME:
+                return max(map(len, MALE_NAMES + FEMALE_NAMES)) + 1 + max(map(len, SURNAMES))
+            case GenerationMode.EMAIL:
+                return max(map(len, MALE_NAMES + FEMALE_NAMES)) + 1 + max(map(len, SURNAMES)) + 1 + max(map(len, KNOWN_EMAIL_DOMAINS))
+            case GenerationMode.PHONE:
+                return GenerateString.PHONE_LENGTH
+            case GenerationMode.NATURALTEXT:
+                return pattern_number * (max(map(len, NATURAL_ENGLISH_WORDS)) + 1) - 1
+            case _:
+                return pattern_number
+
+    def _fill_repeated_values(self, pattern_number: int):
+        # the pool only depends on the attribute seed, so every chunk and every process sees the same one
+        if len(self.repeated_values) == pattern_number:
+            return
+        pool_rng = random.Random(derive_seed(self.seed, "repeating"))
+        self.repeated_values = [
+            "".join(pool_rng.choices(string.ascii_letters, k=pattern_number))
+            for _ in range(pattern_number)
+        ]
 
     def generate(self, pattern_number: int) -> Generator[str, None, None]:
+        if self.generation_mode == GenerationMode.REPEATING:
+            self._fill_repeated_values(pattern_number)
         while self.generated_values < self.quantity:
             self.generated_values += 1
             match self.generation_mode:
                 case GenerationMode.RANDOM:
                     yield "".join(
-                        random.choices(string.ascii_letters, k=pattern_number)
+                        self.rng.choices(string.ascii_letters, k=pattern_number)
                     )
                 case GenerationMode.REPEATING:
-                    if len(self.repeated_values) == pattern_number:
-                        yield self.repeated_values[
-                            self.generated_values % pattern_number
-                        ]
-                    else:
-                        random_str = "".join(
-                            random.choices(string.ascii_letters, k=pattern_number)
-                        )
-                        self.repeated_values.append(random_str)
-                        yield random_str
+                    yield self.repeated_values[
+                        (self.generated_values - 1) % pattern_number
+                    ]
                 case GenerationMode.NAMESURNAME:
-                    NAME_LIST = random.choice([MALE_NAMES, FEMALE_NAMES])
-                    random_name = random.choice(NAME_LIST).title()
-                    random_surname = random.choice(SURNAMES).title()
+                    NAME_LIST = self.rng.choice([MALE_NAMES, FEMALE_NAMES])
+                    random_name = self.rng.choice(NAME_LIST).title()
+                    random_surname = self.rng.choice(SURNAMES).title()
                     random_str = f"{random_name} {random_surname}"
                     yield random_str
                 case GenerationMode.EMAIL:
                     # name.surname@domain.tld
-                    NAME_LIST = random.choice([MALE_NAMES, FEMALE_NAMES])
-                    random_name = random.choice(NAME_LIST)
-                    random_surname = random.choice(SURNAMES)
-                    random_domain = random.choice(KNOWN_EMAIL_DOMAINS)
+                    NAME_LIST = self.rng.choice([MALE_NAMES, FEMALE_NAMES])
+                    random_name = self.rng.choice(NAME_LIST)
+                    random_surname = self.rng.choice(SURNAMES)
+                    random_domain = self.rng.choice(KNOWN_EMAIL_DOMAINS)
                     random_str = f"{random_name}.{random_surname}@{random_domain}"
                     yield random_str
                 case GenerationMode.PHONE:
-                    PHONE_LENGTH = 10
                     random_str = "".join(
-                        random.choices(string.digits, k=PHONE_LENGTH)
+                        self.rng.choices(string.digits, k=self.PHONE_LENGTH)
                     )
                     yield random_str
                 case GenerationMode.NATURALTEXT:
                     random_str = " ".join(
-                        random.choices(NATURAL_ENGLISH_WORDS, k=pattern_number)
+                        self.rng.choices(NATURAL_ENGLISH_WORDS, k=pattern_number)
                     )
                     yield random_str
 
@@ -263,24 +341,36 @@ class GenerateString(ValueGenerator):
 
 class GenerateReal(ValueGenerator):
     current_value: float
-    generated_values: int
+    starting_value: float
 
     def __init__(
         self,
         quantity: int,
         generation_mode: GenerationMode,
         starting_value: float = 0.0,
+        rng: random.Random | None = None,
+        seed: int | None = None,
     ):
-        self.generated_values = 0
         self.current_value = starting_value
-        super().__init__(quantity, generation_mode)
+        self.starting_value = starting_value
+        super().__init__(quantity, generation_mode, rng, seed)
+
+    def seek(self, index: int, pattern_number: float):
+        super().seek(index, pattern_number)
+        match self.generation_mode:
+            case GenerationMode.INCREASING:
+                self.current_value = self.starting_value + index * pattern_number
+            case GenerationMode.DECREASING:
+                self.current_value = self.starting_value - index * pattern_number
+            case GenerationMode.REPEATING:
+                self.current_value = float(repeating_value(self.starting_value, index, pattern_number))
 
     def generate(self, pattern_number: float) -> Generator[float, None, None]:
         while self.generated_values < self.quantity:
             self.generated_values += 1
             match self.generation_mode:
                 case GenerationMode.RANDOM:
-                    yield random.random() * pattern_number
+                    yield self.rng.random() * pattern_number
                 case GenerationMode.INCREASING:
                     value = self.current_value
                     self.current_value += pattern_number
@@ -301,17 +391,27 @@ class GenerateReal(ValueGenerator):
 
 class GenerateDate(ValueGenerator):
     current_value: datetime
-    generated_values: int
+    starting_value: datetime
 
     def __init__(
         self,
         quantity: int,
         generation_mode: GenerationMode,
         starting_value: datetime = datetime.fromtimestamp(0),
+        rng: random.Random | None = None,
+        seed: int | None = None,
     ):
-        self.generated_values = 0
         self.current_value = starting_value
-        super().__init__(quantity, generation_mode)
+        self.starting_value = starting_value
+        super().__init__(quantity, generation_mode, rng, seed)
+
+    def seek(self, index: int, pattern_number: timedelta):
+        super().seek(index, pattern_number)
+        match self.generation_mode:
+            case GenerationMode.INCREASING:
+                self.current_value = self.starting_value + index * pattern_number
+            case GenerationMode.DECREASING:
+                self.current_value = self.starting_value - index * pattern_number
 
     def generate(self, pattern_number: timedelta) -> Generator[datetime, None, None]:
         if not isinstance(pattern_number, timedelta):
@@ -320,7 +420,7 @@ class GenerateDate(ValueGenerator):
             self.generated_values += 1
             match self.generation_mode:
                 case GenerationMode.RANDOM:
-                    yield datetime.fromtimestamp(random.randint(0, 2147483647))
+                    yield datetime.fromtimestamp(self.rng.randint(0, 2147483647))
                 case GenerationMode.INCREASING:
                     value = self.current_value
                     self.current_value += pattern_number
@@ -345,6 +445,8 @@ def value_generator_factory(
     quantity: int,
     generation_mode: GenerationMode = GenerationMode.RANDOM,
     starting_value: _T_TYPES | None = None,
+    rng: random.Random | None = None,
+    seed: int | None = None,
 ) -> ValueGenerator:
     if valid_modes := VALID_PATTERNS_PER_TYPE[db_type]:
         if not valid_modes & generation_mode:
@@ -352,5 +454,5 @@ def value_generator_factory(
     if starting_value is not None:
         if db_type == DbType.STRING:
             raise ValueError("Cannot specify starting value for boolean or string type")
-        return VALUE_GENERATORS[db_type](quantity, generation_mode, starting_value)
-    return VALUE_GENERATORS[db_type](quantity, generation_mode)
+        return VALUE_GENERATORS[db_type](quantity, generation_mode, starting_value, rng=rng, seed=seed)
+    return VALUE_GENERATORS[db_type](quantity, generation_mode, rng=rng, seed=seed)
@@ -0,0 +1,70 @@
+from dataGenerators.dictionary import ValueDictionary, EncodedColumn, InvalidDictionary, parse_dictionary
+from structureReader.testing import GeneratorTestCase
+import csv
+import os
+import random
+import unittest
+
+
+class ValueDictionaryTest(unittest.TestCase):
+    def test_codes_follow_the_weights(self):
+        dictionary = ValueDictionary(["a", "b", "c"], [1, 0, 3])
+        codes = dictionary.codes(random.Random(1), 40000)
+        self.assertEqual(codes.count(1), 0)
+        self.assertAlmostEqual(codes.count(2) / codes.count(0), 3, delta=0.15)
+        self.assertIsNone(dictionary.lookup[dictionary.null_code])
+
+    def test_encoded_columns_decode_lazily(self):
+        dictionary = ValueDictionary(["new", "paid"])
+        column = EncodedColumn(dictionary, [0, 1, 1, dictionary.null_code, 0])
+        self.assertEqual(list(column), ["new", "paid", "paid", None, "new"])
+        self.assertEqual((len(column), column[1], column[3], column.count("paid"), column.count(None)), (5, "paid", None, 2, 1))
+        part = column[1:4]
+        self.assertIsInstance(part, EncodedColumn)
+        self.assertEqual(list(part), ["paid", "paid", None])
+
+    def test_values_are_formatted_once_per_format(self):
+        dictionary = ValueDictionary(["x", "y"])
+        calls = []
+
+        def format(value):
+            calls.append(value)
+            return f"<{value}>"
+        column = EncodedColumn(dictionary, [1, 0, 1, 1])
+        self.assertEqual(column.cells("test", format), ["<y>", "<x>", "<y>", "<y>"])
+        self.assertEqual(column[2:].cells("test", format), ["<y>", "<y>"])
+        self.assertEqual(calls, ["x", "y", None])
+
+    def test_invalid_dictionaries(self):
+        for values, values_file, weights in ((None, None, None), ([], None, None), (["a"], "file.txt", None),
+                                             (["a", "b"], None, [1]), (["a"], None, [-1]), (["a"], None, [0])):
+            with self.subTest(values=values, weights=weights), self.assertRaises(InvalidDictionary):
+                parse_dictionary(values, values_file, weights, str)
+
+
+class EnumOutputTest(GeneratorTestCase):
+    def test_enum_values_are_written_escaped_in_both_formats(self):
+        with open("tiers.txt", "w", encoding="utf-8") as f:
+            f.write("gold\t1\nsilver\t2\nbronze, \"classic\"\t7\n")
+        schema = self.write_schema("enum", [
+            {"name": "accounts", "rows": 20000, "attributes": [
+                {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+                {"name": "status", "type": "string", "generation": "enum", "values": ["active", "O'Hara", "two\nlines"], "weights": [8, 1, 1]},
+                {"name": "tier", "type": "string", "generation": "enum", "values_file": "tiers.txt", "null_fraction": 0.1},
+                {"name": "level", "type": "integer", "generation": "enum", "values": [1, 2, 3]}]}])
+        self.generate("-f", schema, "-c", "-s", "--seed", "7")
+        with open(os.path.join("enum", "accounts.csv"), newline="", encoding="utf-8") as f:
+            rows = list(csv.DictReader(f))
+        self.assertEqual(len(rows), 20000)
+        self.assertEqual({row["status"] for row in rows}, {"active", "O'Hara", "two\nlines"})
+        self.assertEqual({row["tier"] for row in rows}, {"gold", "silver", 'bronze, "classic"', ""})
+        self.assertEqual({row["level"] for row in rows}, {"1", "2", "3"})
+        tiers = [row["tier"] for row in rows if row["tier"]]
+        self.assertAlmostEqual(tiers.count("gold") / len(tiers), 0.1, delta=0.02)
+        sql = self.read("enum.sql").decode("utf-8")
+        self.assertIn("'O''Hara'", sql)
+        self.assertIn("'bronze, \"classic\"'", sql)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,71 @@
+from dataGenerators.distributions import parse_distribution, InvalidDistribution
+from structureReader.testing import GeneratorTestCase
+from statistics import fmean, stdev
+import csv
+import os
+import random
+import unittest
+
+SAMPLES = 50000
+
+
+def sample(spec, integer: bool = False, step: float = 100) -> list:
+    return parse_distribution(spec, integer, step).sample(random.Random(7), SAMPLES)
+
+
+class DistributionTest(unittest.TestCase):
+    def test_samples_follow_their_distribution(self):
+        values = sample({"type": "normal", "mean": 50, "stddev": 10})
+        self.assertAlmostEqual(fmean(values), 50, delta=0.3)
+        self.assertAlmostEqual(stdev(values), 10, delta=0.3)
+        self.assertAlmostEqual(fmean(sample({"type": "exponential", "rate": 0.5})), 2, delta=0.05)
+        values = sample("uniform", integer=True, step=9)
+        self.assertEqual(set(values), set(range(10)))
+        self.assertAlmostEqual(values.count(0) / SAMPLES, 0.1, delta=0.01)
+
+    def test_zipf_ranks_have_decreasing_frequencies(self):
+        values = sample({"type": "zipf", "n": 100}, integer=True)
+        self.assertTrue(all(1 <= value <= 100 for value in values))
+        # with s = 1 rank 1 is twice as frequent as rank 2
+        self.assertAlmostEqual(values.count(1) / values.count(2), 2, delta=0.15)
+        # larger domains use the continuous approximation, which stays within the ranks
+        values = sample({"type": "zipf", "n": 1 << 20, "s": 1.2}, integer=True)
+        self.assertTrue(all(1 <= value <= 1 << 20 for value in values))
+        self.assertGreater(values.count(1), values.count(2))
+
+    def test_min_and_max_clip_the_values(self):
+        values = sample({"type": "normal", "mean": 0, "stddev": 5, "min": -1, "max": 1})
+        self.assertEqual((min(values), max(values)), (-1, 1))
+        self.assertTrue(all(isinstance(value, int) for value in sample({"type": "lognormal", "max": 1e6}, integer=True)))
+
+    def test_invalid_specifications(self):
+        for spec in ("poisson", {"mean": 1}, {"type": "normal", "stddev": 0}, {"type": "normal", "mu": 1},
+                     {"type": "uniform", "low": 5, "high": 1}, {"type": "zipf", "n": 0}, {"type": "normal", "min": 2, "max": 1},
+                     {"type": "exponential", "rate": "fast"}):
+            with self.subTest(spec=spec), self.assertRaises(InvalidDistribution):
+                parse_distribution(spec, False, 10)
+
+
+class NullFractionTest(GeneratorTestCase):
+    def test_nulls_leave_the_other_values_unchanged(self):
+        attributes = [{"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+                      {"name": "x", "type": "real", "generation": "random", "distribution": {"type": "normal", "mean": 10, "stddev": 2}}]
+        self.write_schema("plain", [{"name": "T", "rows": 20000, "attributes": attributes}])
+        attributes[1]["null_fraction"] = 0.25
+        self.write_schema("nulls", [{"name": "T", "rows": 20000, "attributes": attributes}])
+        self.generate("-f", "plain.json", "-c", "--seed", "3")
+        self.generate("-f", "nulls.json", "-c", "-s", "--seed", "3")
+        with open(os.path.join("plain", "T.csv"), newline="") as f:
+            plain = [row["x"] for row in csv.DictReader(f)]
+        with open(os.path.join("nulls", "T.csv"), newline="") as f:
+            nulls = [row["x"] for row in csv.DictReader(f)]
+        self.assertAlmostEqual(nulls.count("") / len(nulls), 0.25, delta=0.02)
+        self.assertTrue(all(value == "" or value == original for value, original in zip(nulls, plain)))
+        sql = self.read("nulls.sql").decode()
+        self.assertIn("NULL)", sql)
+        column, = [line for line in sql.splitlines() if line.strip().startswith("x ")]
+        self.assertNotIn("NOT NULL", column)
+
+
+if __name__ == "__main__":
+    unittest.main()
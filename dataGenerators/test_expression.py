@@ -0,0 +1,82 @@
+from dataGenerators.expression import CompiledExpression, InvalidExpression
+from structureReader.testing import GeneratorTestCase
+from typeWrappers.types import DbType
+from datetime import datetime, timedelta
+import csv
+import os
+import unittest
+
+COLUMNS = {
+    "qty": (DbType.INTEGER, None),
+    "price": (DbType.REAL, None),
+    "status": (DbType.STRING, 6),
+    "day": (DbType.DATE, None),
+}
+VALUES = {
+    "qty": [1, 2, 7],
+    "price": [0.5, 2.0, 1.5],
+    "status": ["new", "paid", "closed"],
+    "day": [datetime(2020, 1, 31), datetime(2020, 2, 28), datetime(2021, 12, 31)],
+}
+
+
+def evaluate(text: str, target: DbType, lo: int = 10, chunk_rows: int = 4096) -> list:
+    expression = CompiledExpression(text, target, COLUMNS)
+    return expression.evaluate(VALUES, lo, lo + 3, 1, chunk_rows)
+
+
+class ExpressionTest(unittest.TestCase):
+    def test_operators_follow_precedence_and_types(self):
+        self.assertEqual(evaluate("qty * price + 1", DbType.REAL), [1.5, 5.0, 11.5])
+        self.assertEqual(evaluate("qty // 2 + qty % 2 * 10", DbType.INTEGER), [10, 1, 13])
+        self.assertEqual(evaluate("qty / 2", DbType.REAL), [0.5, 1.0, 3.5])
+        # integers are accepted for real attributes
+        self.assertEqual(evaluate("qty - 1", DbType.REAL), [0.0, 1.0, 6.0])
+        self.assertEqual(evaluate("if(qty > 1 and not status == 'paid', upper(status), status)", DbType.STRING), ["new", "paid", "CLOSED"])
+        self.assertEqual(evaluate("row()", DbType.INTEGER), [10, 11, 12])
+
+    def test_dates_and_strings(self):
+        self.assertEqual(evaluate("day + days(1)", DbType.DATE), [datetime(2020, 2, 1), datetime(2020, 2, 29), datetime(2022, 1, 1)])
+        self.assertEqual(evaluate("year(day) * 100 + month(day)", DbType.INTEGER), [202001, 202002, 202112])
+        expression = CompiledExpression("concat(status, '-', qty)", DbType.STRING, COLUMNS)
+        self.assertEqual(expression.evaluate(VALUES, 0, 3, 1, 4096), ["new-1", "paid-2", "closed-7"])
+        # the DDL length covers the longest string the expression can build
+        self.assertGreaterEqual(expression.max_length, 6 + 1 + len(str(-(1 << 63))))
+        self.assertEqual(CompiledExpression.referenced_names("concat(status, '-', qty)"), {"status", "qty"})
+
+    def test_invalid_expressions_are_rejected_when_compiled(self):
+        for text, target in (("qty + 'a'", DbType.INTEGER), ("qty * price", DbType.INTEGER), ("missing + 1", DbType.INTEGER),
+                             ("nope(qty)", DbType.INTEGER), ("qty +", DbType.INTEGER), ("day + 1", DbType.DATE)):
+            with self.subTest(text=text), self.assertRaises(InvalidExpression):
+                CompiledExpression(text, target, COLUMNS)
+
+    def test_random_values_do_not_depend_on_the_batches(self):
+        expression = CompiledExpression("randint(1, 6)", DbType.INTEGER, {})
+        whole = expression.evaluate({}, 0, 10000, 3, 4096)
+        self.assertEqual(expression.evaluate({}, 4000, 9000, 3, 4096), whole[4000:9000])
+        self.assertEqual(set(whole), {1, 2, 3, 4, 5, 6})
+        self.assertNotEqual(expression.evaluate({}, 0, 10000, 4, 4096), whole)
+
+
+class DerivedColumnsTest(GeneratorTestCase):
+    def test_expressions_see_the_values_of_their_row(self):
+        schema = self.write_schema("orders", [
+            {"name": "orders", "rows": 5000, "attributes": [
+                # total is declared before the expression it depends on
+                {"name": "total", "type": "real", "generation": "expression", "expression": "net * 1.25"},
+                {"name": "qty", "type": "integer", "generation": "random", "step": 20},
+                {"name": "net", "type": "real", "generation": "expression", "expression": "qty * 4"},
+                {"name": "shipped", "type": "date", "generation": "expression", "expression": "date('2024-01-01') + days(qty)"}]}])
+        self.generate("-f", schema, "-c", "--seed", "9")
+        with open(os.path.join("orders", "orders.csv"), newline="") as f:
+            rows = list(csv.DictReader(f))
+        self.assertEqual(len(rows), 5000)
+        for row in rows:
+            qty = int(row["qty"])
+            self.assertEqual(float(row["net"]), qty * 4)
+            self.assertEqual(float(row["total"]), qty * 5)
+            self.assertEqual(datetime.fromisoformat(row["shipped"]), datetime(2024, 1, 1) + timedelta(days=qty))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,84 @@
+from dataGenerators.timeseries import EventStream, InvalidTimeSeries, parse_time_series
+from structureReader.testing import GeneratorTestCase
+from datetime import datetime, timedelta
+import csv
+import os
+import re
+import unittest
+
+START = datetime(2024, 1, 1)
+INTERVAL = timedelta(seconds=10)
+
+
+class EventStreamTest(unittest.TestCase):
+    def test_events_are_in_time_order_and_every_entity_keeps_its_pace(self):
+        stream = EventStream(50, START, INTERVAL, 0.3, 5)
+        entities, timestamps = stream.events(0, 5000)
+        self.assertEqual(timestamps, sorted(timestamps))
+        self.assertGreaterEqual(timestamps[0], START)
+        last: dict[int, datetime] = {}
+        for row, (entity, timestamp) in enumerate(zip(entities, timestamps)):
+            # row r is the (r // entities)-th event of its entity
+            self.assertEqual(sorted(entities[row // 50 * 50:row // 50 * 50 + 50]), list(range(50)))
+            if entity in last:
+                gap = timestamp - last[entity]
+                self.assertGreaterEqual(gap, INTERVAL * 0.7 - timedelta(microseconds=1))
+                self.assertLessEqual(gap, INTERVAL * 1.3 + timedelta(microseconds=1))
+            last[entity] = timestamp
+        # timestamps have microseconds
+        self.assertTrue(any(timestamp.microsecond for timestamp in timestamps))
+
+    def test_any_row_range_is_the_same_slice(self):
+        whole = EventStream(7, START, INTERVAL, 1, 2).events(0, 1000)
+        for lo, hi in ((0, 1), (3, 10), (500, 1000), (123, 456)):
+            entities, timestamps = EventStream(7, START, INTERVAL, 1, 2).events(lo, hi)
+            self.assertEqual((entities, timestamps), (whole[0][lo:hi], whole[1][lo:hi]))
+
+    def test_invalid_specifications(self):
+        for spec in ("readings", {"entity": "device"}, {"entity": "device", "timestamp": "ts", "jitter": 2}):
+            with self.subTest(spec=spec), self.assertRaises(InvalidTimeSeries):
+                parse_time_series(spec)
+        with self.assertRaises(InvalidTimeSeries):
+            EventStream(0, START, INTERVAL, 0.5, 1)
+        with self.assertRaises(InvalidTimeSeries):
+            EventStream(3, START, timedelta(0), 0.5, 1)
+
+
+class TimeSeriesTableTest(GeneratorTestCase):
+    TABLES = [
+        {"name": "devices", "rows": 200, "primary_keys": ["id"], "attributes": [
+            {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+            {"name": "installed", "type": "date", "start": "2020-01-01", "step": {"days": 1}}]},
+        {"name": "readings", "rows": 10000, "time_series": {"entity": "device_id", "timestamp": "ts", "jitter": 0.3}, "attributes": [
+            {"name": "device_id", "type": "foreign_key", "references": {"table": "devices", "attribute": "id"}},
+            {"name": "ts", "type": "date", "start": "2024-01-01", "step": {"seconds": 10}},
+            {"name": "value", "type": "real", "generation": "random", "step": 100}]},
+    ]
+
+    def test_readings_are_events_of_the_devices(self):
+        schema = self.write_schema("ts", self.TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "3")
+        with open(os.path.join("ts", "readings.csv"), newline="") as f:
+            rows = list(csv.DictReader(f))
+        timestamps = [datetime.fromisoformat(row["ts"]) for row in rows]
+        self.assertEqual(timestamps, sorted(timestamps))
+        self.assertEqual({row["device_id"] for row in rows}, {str(i) for i in range(1, 201)})
+        # the timestamp column keeps its microseconds, other dates stay dates in postgres
+        sql = self.read("ts.sql").decode()
+        self.assertRegex(sql, r"\bts TIMESTAMP NOT NULL")
+        self.assertRegex(sql, r"\binstalled DATE NOT NULL")
+
+    def test_oracle_timestamps_keep_their_microseconds(self):
+        schema = self.write_schema("ts", self.TABLES)
+        self.generate("-f", schema, "-s", "-d", "oracle", "--seed", "3")
+        sql = self.read("ts.sql").decode()
+        literals = re.findall(r"TO_TIMESTAMP\('([^']*)', '([^']*)'\)", sql)
+        # the installation dates of the devices and the timestamps of the readings
+        self.assertEqual(len(literals), 200 + 10000)
+        for text, mask in literals:
+            self.assertEqual(mask, "YYYY-MM-DD HH24:MI:SS.FF6")
+            self.assertRegex(text, r"^\d{4}-\d\d-\d\d \d\d:\d\d:\d\d\.\d{6}$")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,103 @@
+from __future__ import annotations
+from array import array
+from datetime import datetime, timedelta
+from typing import Any
+from dataGenerators.generators import derive_seed
+import random
+
+_MICROSECOND = timedelta(microseconds=1)
+
+
+class InvalidTimeSeries(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+class TimeSeriesSpec:
+    # "time_series" of a table: the foreign key naming the entity of every event, the date attribute
+    # holding its timestamp (whose start and step are the first interval and the interval) and how much
+    # of the interval the events of an entity move around
+    entity: str
+    timestamp: str
+    jitter: float
+
+    def __init__(self, entity: str, timestamp: str, jitter: float):
+        self.entity = entity
+        self.timestamp = timestamp
+        self.jitter = jitter
+
+
+def parse_time_series(spec: Any) -> TimeSeriesSpec:
+    if not isinstance(spec, dict):
+        raise InvalidTimeSeries("'time_series' must be an object with keys 'entity' and 'timestamp'")
+    for key in ("entity", "timestamp"):
+        if not isinstance(spec.get(key), str):
+            raise InvalidTimeSeries(f"'time_series' must name its {key} attribute in '{key}'")
+    try:
+        jitter = float(spec.get("jitter", 0.5))
+    except (TypeError, ValueError):
+        raise InvalidTimeSeries("the jitter of a time series must be a number")
+    if not 0 <= jitter <= 1:
+        raise InvalidTimeSeries("the jitter of a time series must be within [0, 1]")
+    return TimeSeriesSpec(spec["entity"], spec["timestamp"], jitter)
+
+
+class EventStream:
+    # the events of many entities merged in time order. Every entity emits one event per interval, at a
+    # phase of its own within the interval plus a jitter drawn for every event, so its timestamps always
+    # increase. Round r holds the r-th event of every entity and lies within [start + r * interval,
+    # start + (r + 1) * interval): rounds follow each other in time and only the events of one round have
+    # to be sorted (a calendar queue with one bucket per interval). Row i is then entry i % entities of
+    # round i // entities, any row range is generated without the rows before it
+    entities: int
+    start: datetime
+    interval: timedelta
+    jitter: float
+
+    def __init__(self, entities: int, start: datetime, interval: timedelta, jitter: float, seed: int):
+        if entities <= 0:
+            raise InvalidTimeSeries("a time series needs at least one entity")
+        if interval <= timedelta(0):
+            raise InvalidTimeSeries("the interval of a time series must be positive")
+        if not 0 <= jitter <= 1:
+            raise InvalidTimeSeries("the jitter of a time series must be within [0, 1]")
+        self.entities = entities
+        self.start = start
+        self.interval = interval
+        self.jitter = jitter
+        self._seed = seed
+        micros = interval // _MICROSECOND
+        # phases and jitter share the interval, their sum stays below it
+        self._spread = float(int(micros * jitter))
+        phase_range = micros - int(self._spread)
+        rng = random.Random(derive_seed(seed, "phase"))
+        self._phases = array("d", (float(rng.randrange(phase_range)) if phase_range > 0 else 0.0 for _ in range(entities)))
+        self._round: tuple[int, array, array] | None = None
+
+    def _sorted_round(self, number: int) -> tuple[array, array]:
+        # entity of every event of the round in time order, and its offset from the start of the round in microseconds
+        if self._round is not None and self._round[0] == number:
+            return self._round[1], self._round[2]
+        rand = random.Random(derive_seed(self._seed, number)).random
+        spread = self._spread
+        # fractions of a microsecond only order the events, timestamps are truncated to whole microseconds
+        offsets = [phase + rand() * spread for phase in self._phases]
+        order = sorted(range(self.entities), key=offsets.__getitem__)
+        sorted_offsets = array("d", map(offsets.__getitem__, order))
+        self._round = (number, array("q", order), sorted_offsets)
+        return self._round[1], self._round[2]
+
+    def events(self, lo: int, hi: int) -> tuple[list[int], list[datetime]]:
+        # entity indexes and timestamps of rows [lo, hi)
+        entities: list[int] = []
+        timestamps: list[datetime] = []
+        row = lo
+        while row < hi:
+            number, first = divmod(row, self.entities)
+            last = min(self.entities, first + hi - row)
+            order, offsets = self._sorted_round(number)
+            base = self.start + number * self.interval
+            entities.extend(order[first:last])
+            timestamps.extend(map(base.__add__, map(_MICROSECOND.__mul__, map(int, offsets[first:last]))))
+            row += last - first
+        return entities, timestamps
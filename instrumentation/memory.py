@@ -0,0 +1,201 @@
+from __future__ import annotations
+import ctypes
+import gc
+import os
+import sys
+import threading
+
+MEGABYTE = 1 << 20
+# bytes a generated value costs while its batch is alive: the object, its list slot and its formatted text
+CELL_BYTES = 120
+# an interpreter running sort workers, before any rows are sorted in it
+SORT_WORKER_BYTES = 48 * MEGABYTE
+# batches are sized to stay under this fraction of the limit, the rest is slack for the allocator
+_HIGH_WATER = 0.85
+# share of the limit that output waiting for the writer threads may use
+_QUEUE_SHARE = 0.25
+
+try:
+    import resource
+except ImportError:  # Windows
+    resource = None  # type: ignore
+
+
+class _ProcessMemoryCounters(ctypes.Structure):
+    _fields_ = [
+        ("cb", ctypes.c_ulong),
+        ("PageFaultCount", ctypes.c_ulong),
+        ("PeakWorkingSetSize", ctypes.c_size_t),
+        ("WorkingSetSize", ctypes.c_size_t),
+        ("QuotaPeakPagedPoolUsage", ctypes.c_size_t),
+        ("QuotaPagedPoolUsage", ctypes.c_size_t),
+        ("QuotaPeakNonPagedPoolUsage", ctypes.c_size_t),
+        ("QuotaNonPagedPoolUsage", ctypes.c_size_t),
+        ("PagefileUsage", ctypes.c_size_t),
+        ("PeakPagefileUsage", ctypes.c_size_t),
+    ]
+
+
+def _windows_counters() -> _ProcessMemoryCounters | None:
+    counters = _ProcessMemoryCounters()
+    counters.cb = ctypes.sizeof(counters)
+    process = ctypes.windll.kernel32.GetCurrentProcess()  # type: ignore
+    if not ctypes.windll.psapi.GetProcessMemoryInfo(process, ctypes.byref(counters), counters.cb):  # type: ignore
+        return None
+    return counters
+
+
+def current_rss() -> int | None:
+    # resident memory of this process, None where it cannot be measured
+    try:
+        if sys.platform == "win32":
+            counters = _windows_counters()
+            return counters.WorkingSetSize if counters else None
+        with open("/proc/self/statm", "r") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError, AttributeError):
+        return None
+
+
+def _max_rss(who: int | None = None) -> int | None:
+    # highest resident memory the process (or its waited for children) ever had
+    if sys.platform == "win32":
+        if who is not None:
+            return None
+        counters = _windows_counters()
+        return counters.PeakWorkingSetSize if counters else None
+    if resource is None:
+        return None
+    peak = resource.getrusage(resource.RUSAGE_SELF if who is None else who).ru_maxrss
+    # kilobytes on Linux, bytes on macOS
+    return peak if sys.platform == "darwin" else peak * 1024
+
+
+def _trim():
+    # hands the memory freed by the last batches back to the system, so that it stops counting
+    gc.collect()
+    if sys.platform.startswith("linux"):
+        try:
+            ctypes.CDLL("libc.so.6").malloc_trim(0)
+        except (OSError, AttributeError):
+            pass
+
+
+class MemoryGovernor:
+    # keeps a run under a memory limit: batches are sized from the memory left, output waiting for the writer
+    # threads is bounded (writers block instead of queueing more) and caches are capped. Without a limit it
+    # only records the peak
+    limit: int | None
+    peak: int
+
+    def __init__(self):
+        self.limit = None
+        self.peak = 0
+        self.throttled = 0
+        self._queued = 0
+        self._queue = threading.Condition()
+        self._batch_bytes = 0
+        self._start_max = None
+        self._start_children = None
+
+    def configure(self, limit: int | None):
+        # starts a run, the peak is the one of this run even when the process ran others before
+        self.limit = limit
+        self.peak = 0
+        self.throttled = 0
+        self._batch_bytes = 0
+        self._start_max = _max_rss()
+        self._start_children = _max_rss(resource.RUSAGE_CHILDREN) if resource is not None else None
+        self.sample()
+
+    def sample(self) -> int | None:
+        rss = current_rss()
+        if rss is not None and rss > self.peak:
+            self.peak = rss
+        return rss
+
+    def _available(self) -> int | None:
+        # memory a batch may take now, the previous batch is garbage by the time the next one is sized
+        rss = self.sample()
+        if self.limit is None or rss is None:
+            return None
+        available = int(self.limit * _HIGH_WATER) - rss + self._batch_bytes - (self.queue_limit() - self._queued)
+        if available < self._batch_bytes:
+            _trim()
+            rss = self.sample() or rss
+            available = int(self.limit * _HIGH_WATER) - rss + self._batch_bytes - (self.queue_limit() - self._queued)
+        return available
+
+    def batch_rows(self, columns: int, max_rows: int, step: int) -> int:
+        # rows of the next batch, a multiple of step between step and max_rows
+        available = self._available()
+        if available is None:
+            return max_rows
+        rows = max_rows
+        fitting = available // (max(1, columns) * CELL_BYTES)
+        if fitting < rows:
+            rows = max(step, fitting // step * step)
+            self.throttled += 1
+        self._batch_bytes = rows * max(1, columns) * CELL_BYTES
+        return rows
+
+    def workers(self, workers: int, batch_rows: int, columns: int) -> int:
+        # processes sorting batches at the same time, every one holds a batch of its own
+        available = self._available()
+        if available is None:
+            return workers
+        fitting = max(1, available // (SORT_WORKER_BYTES + 3 * batch_rows * max(1, columns) * CELL_BYTES))
+        return max(1, min(workers, fitting))
+
+    def cache_cells(self, cells: int) -> int:
+        # generated values a cache may keep
+        if self.limit is None:
+            return cells
+        return min(cells, int(self.limit * _QUEUE_SHARE) // CELL_BYTES)
+
+    def queue_limit(self) -> int:
+        return int(self.limit * _QUEUE_SHARE) if self.limit is not None else 0
+
+    def reserve(self, size: int):
+        # output handed to a writer thread, waits while too much is queued already (but never for nothing queued)
+        if self.limit is None:
+            return
+        with self._queue:
+            while self._queued > 0 and self._queued + size > self.queue_limit():
+                self._queue.wait()
+            self._queued += size
+
+    def release(self, size: int):
+        if self.limit is None:
+            return
+        with self._queue:
+            self._queued -= size
+            self._queue.notify_all()
+
+    def peak_bytes(self) -> int:
+        # getrusage knows the exact peak, unless it was reached before this run started
+        peak = _max_rss()
+        if peak is not None and (self._start_max is None or peak > self._start_max):
+            return max(peak, self.peak)
+        return self.peak
+
+    def children_peak_bytes(self) -> int | None:
+        if resource is None:
+            return None
+        peak = _max_rss(resource.RUSAGE_CHILDREN)
+        if not peak or (self._start_children is not None and peak <= self._start_children):
+            return None
+        return peak
+
+    def report(self) -> str:
+        text = f"Peak memory {self.peak_bytes() / MEGABYTE:.1f} MB"
+        if self.limit is not None:
+            text += f" of {self.limit / MEGABYTE:.0f} MB limit"
+        if (children := self.children_peak_bytes()) is not None:
+            text += f", largest child process {children / MEGABYTE:.1f} MB"
+        if self.throttled:
+            text += f", {self.throttled} batch(es) were made smaller to stay under the limit"
+        return text
+
+
+GOVERNOR = MemoryGovernor()
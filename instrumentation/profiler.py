@@ -0,0 +1,188 @@
+from __future__ import annotations
+from dataclasses import dataclass, field
+from time import perf_counter_ns
+import json
+import os
+import threading
+import tracemalloc
+
+
+@dataclass
+class StageStats:
+    stage: str
+    table: str | None
+    attribute: str | None
+    calls: int = 0
+    elapsed_ns: int = 0
+    rows: int = 0
+    bytes: int = 0
+    allocations: int = 0
+
+    def to_json(self) -> dict:
+        return {
+            "stage": self.stage,
+            "table": self.table,
+            "attribute": self.attribute,
+            "calls": self.calls,
+            "elapsed_ms": self.elapsed_ns / 1_000_000,
+            "rows": self.rows,
+            "bytes": self.bytes,
+            "allocations": self.allocations,
+        }
+
+
+class _NullScope:
+    # shared by every disabled scope, so a disabled profiler costs one method call
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        return False
+
+    def add(self, rows: int = 0, bytes: int = 0):
+        pass
+
+
+_NULL_SCOPE = _NullScope()
+
+
+class _Scope:
+    __slots__ = ("_profiler", "_key", "_start", "_alloc_start", "rows", "bytes")
+
+    def __init__(self, profiler: Profiler, key: tuple[str, str | None, str | None]):
+        self._profiler = profiler
+        self._key = key
+        self.rows = 0
+        self.bytes = 0
+
+    def __enter__(self):
+        if self._profiler._track_allocations:
+            self._alloc_start = tracemalloc.get_traced_memory()[0]
+        self._start = perf_counter_ns()
+        return self
+
+    def __exit__(self, *exc):
+        end = perf_counter_ns()
+        allocated = 0
+        if self._profiler._track_allocations:
+            allocated = max(0, tracemalloc.get_traced_memory()[0] - self._alloc_start)
+        self._profiler._record(self._key, self._start, end, self.rows, self.bytes, allocated)
+        return False
+
+    def add(self, rows: int = 0, bytes: int = 0):
+        self.rows += rows
+        self.bytes += bytes
+
+
+class Profiler:
+    enabled: bool
+    _track_allocations: bool
+    _stats: dict[tuple[str, str | None, str | None], StageStats]
+    _events: list[dict]
+    _origin_ns: int
+
+    def __init__(self):
+        self.enabled = False
+        self._track_allocations = False
+        self._lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        self._stats = {}
+        self._events = []
+        self._origin_ns = perf_counter_ns()
+
+    def enable(self, track_allocations: bool = False):
+        self.enabled = True
+        self._track_allocations = track_allocations
+        if track_allocations and not tracemalloc.is_tracing():
+            tracemalloc.start()
+        self.reset()
+
+    def disable(self):
+        self.enabled = False
+        if self._track_allocations and tracemalloc.is_tracing():
+            tracemalloc.stop()
+        self._track_allocations = False
+
+    def stage(self, name: str, table: str | None = None, attribute: str | None = None):
+        if not self.enabled:
+            return _NULL_SCOPE
+        return _Scope(self, (name, table, attribute))
+
+    def count(self, name: str, rows: int = 0, bytes: int = 0, table: str | None = None, attribute: str | None = None):
+        if not self.enabled:
+            return
+        with self._lock:
+            stats = self._stats_for((name, table, attribute))
+            stats.rows += rows
+            stats.bytes += bytes
+
+    def _stats_for(self, key: tuple[str, str | None, str | None]) -> StageStats:
+        stats = self._stats.get(key)
+        if stats is None:
+            stats = StageStats(*key)
+            self._stats[key] = stats
+        return stats
+
+    def _record(self, key: tuple[str, str | None, str | None], start: int, end: int, rows: int, nbytes: int, allocated: int):
+        with self._lock:
+            stats = self._stats_for(key)
+            stats.calls += 1
+            stats.elapsed_ns += end - start
+            stats.rows += rows
+            stats.bytes += nbytes
+            stats.allocations += allocated
+            name, table, attribute = key
+            args = {"rows": rows, "bytes": nbytes}
+            if table is not None:
+                args["table"] = table
+            if attribute is not None:
+                args["attribute"] = attribute
+            if self._track_allocations:
+                args["allocated_bytes"] = allocated
+            label = ".".join(part for part in (table, attribute) if part)
+            self._events.append({
+                "name": f"{name} {label}" if label else name,
+                "cat": name,
+                "ph": "X",
+                "ts": (start - self._origin_ns) / 1000,
+                "dur": (end - start) / 1000,
+                "pid": os.getpid(),
+                "tid": threading.get_ident(),
+                "args": args,
+            })
+
+    def summary(self) -> list[StageStats]:
+        return sorted(self._stats.values(), key=lambda x: x.elapsed_ns, reverse=True)
+
+    def format_summary(self) -> str:
+        header = ("stage", "table", "attribute", "calls", "ms", "rows", "bytes", "alloc")
+        lines = [header]
+        for stats in self.summary():
+            lines.append((
+                stats.stage,
+                stats.table or "-",
+                stats.attribute or "-",
+                str(stats.calls),
+                f"{stats.elapsed_ns / 1_000_000:.3f}",
+                str(stats.rows),
+                str(stats.bytes),
+                str(stats.allocations),
+            ))
+        widths = [max(len(line[i]) for line in lines) for i in range(len(header))]
+        return "\n".join(
+            "  ".join(col.ljust(widths[i]) if i < 3 else col.rjust(widths[i]) for i, col in enumerate(line))
+            for line in lines
+        )
+
+    def write_summary(self, filename: str):
+        with open(filename, "w") as f:
+            json.dump({"stages": [stats.to_json() for stats in self.summary()]}, f, indent=2)
+
+    def write_chrome_trace(self, filename: str):
+        with open(filename, "w") as f:
+            json.dump({"traceEvents": self._events, "displayTimeUnit": "ms"}, f)
+
+
+PROFILER = Profiler()
@@ -0,0 +1,62 @@
+from instrumentation.memory import MemoryGovernor, current_rss, MEGABYTE
+from structureReader.testing import GeneratorTestCase
+import threading
+import unittest
+
+
+class MemoryGovernorTest(unittest.TestCase):
+    def test_without_a_limit_nothing_is_throttled(self):
+        governor = MemoryGovernor()
+        governor.configure(None)
+        self.assertEqual(governor.batch_rows(10, 65536, 4096), 65536)
+        self.assertEqual(governor.workers(8, 65536, 10), 8)
+        self.assertEqual(governor.cache_cells(1 << 20), 1 << 20)
+        governor.reserve(1 << 40)
+        self.assertEqual(governor.throttled, 0)
+
+    @unittest.skipIf(current_rss() is None, "the memory use of the process is unknown")
+    def test_batches_shrink_to_a_chunk_under_a_tight_limit(self):
+        governor = MemoryGovernor()
+        # far below what the interpreter already uses
+        governor.configure(MEGABYTE)
+        self.assertEqual(governor.batch_rows(10, 65536, 4096), 4096)
+        self.assertEqual(governor.workers(8, 4096, 10), 1)
+        self.assertEqual(governor.throttled, 1)
+        self.assertLess(governor.cache_cells(1 << 20), 1 << 20)
+        self.assertIn("1 batch(es) were made smaller", governor.report())
+
+    def test_queued_output_waits_for_the_writers(self):
+        governor = MemoryGovernor()
+        governor.configure(400)
+        self.assertEqual(governor.queue_limit(), 100)
+        governor.reserve(80)
+        reserved = threading.Event()
+        thread = threading.Thread(target=lambda: (governor.reserve(50), reserved.set()))
+        thread.start()
+        self.assertFalse(reserved.wait(0.2))
+        governor.release(80)
+        self.assertTrue(reserved.wait(5))
+        thread.join()
+        # more than the queue limit is accepted when nothing else is queued
+        governor.release(50)
+        governor.reserve(1000)
+
+
+class MemoryLimitTest(GeneratorTestCase):
+    @unittest.skipIf(current_rss() is None, "the memory use of the process is unknown")
+    def test_limited_run_writes_the_same_output(self):
+        schema = self.write_schema("lim", [
+            {"name": "T", "rows": 100000, "attributes": [
+                {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+                {"name": "s", "type": "string", "length": 12},
+                {"name": "x", "type": "real", "generation": "random", "step": 10}]}])
+        self.generate("-f", schema, "-c", "--seed", "1")
+        unlimited = self.read_tree("lim")
+        result = self.generate("-f", schema, "-c", "--seed", "1", "--memory-limit", "40")
+        self.assertEqual(self.read_tree("lim"), unlimited)
+        self.assertIn("of 40 MB limit", result.stdout)
+        self.assertIn("were made smaller", result.stdout)
+
+
+if __name__ == "__main__":
+    unittest.main()
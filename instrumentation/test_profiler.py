@@ -0,0 +1,51 @@
+from instrumentation.profiler import Profiler
+from structureReader.testing import GeneratorTestCase
+import json
+import os
+import unittest
+
+
+class ProfilerTest(unittest.TestCase):
+    def test_disabled_profiler_records_nothing(self):
+        profiler = Profiler()
+        with profiler.stage("generate", "T") as scope:
+            scope.add(rows=10)
+        profiler.count("row_cache_hit", rows=5)
+        self.assertEqual(profiler.summary(), [])
+
+    def test_stages_add_up_per_key(self):
+        profiler = Profiler()
+        profiler.enable()
+        for rows in (3, 4):
+            with profiler.stage("generate", "T", "a") as scope:
+                scope.add(rows=rows, bytes=2 * rows)
+        with profiler.stage("generate", "T", "b") as scope:
+            scope.add(rows=1)
+        stats = {stats.attribute: stats for stats in profiler.summary()}
+        self.assertEqual((stats["a"].calls, stats["a"].rows, stats["a"].bytes), (2, 7, 14))
+        self.assertEqual((stats["b"].calls, stats["b"].rows), (1, 1))
+
+
+class ProfiledRunTest(GeneratorTestCase):
+    def test_profile_and_trace_cover_every_written_row(self):
+        schema = self.write_schema("prof", [
+            {"name": "T", "rows": 10000, "primary_keys": ["id"], "attributes": [
+                {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+                {"name": "s", "type": "string", "length": 12}]}])
+        self.generate("-f", schema, "-c", "-s", "--seed", "1", "-p")
+        with open("prof.profile.json") as f:
+            stages = json.load(f)["stages"]
+        rows = {(stage["stage"], stage["table"]): stage["rows"] for stage in stages}
+        self.assertEqual(rows[("write_csv", "T")], 10000)
+        self.assertEqual(rows[("write_sql", "T")], 10000)
+        written = sum(stage["bytes"] for stage in stages if stage["stage"] == "write_csv")
+        self.assertEqual(written, os.path.getsize(os.path.join("prof", "T.csv")))
+        with open("prof.trace.json") as f:
+            events = json.load(f)["traceEvents"]
+        self.assertTrue(events)
+        self.assertTrue(all(event["ph"] == "X" and event["dur"] >= 0 for event in events))
+        self.assertIn("parse_json_schema", {event["cat"] for event in events})
+
+
+if __name__ == "__main__":
+    unittest.main()
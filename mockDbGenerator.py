@@ -1,33 +1,233 @@
-from structureReader.reader import parse_json_schema, InvalidSchema
+from structureReader.reader import parse_json_schema, DbSchema, InvalidSchema
+from structureReader.shard import generate_shard, merge_shards, verify_shards, run_local_shards, InvalidShards
+from structureReader.checkpoint import Checkpoint, CheckpointMismatch
+from structureReader.calibration import calibrate
+from structureReader.workload import generate_workload, parse_mix, InvalidWorkload
+from structureReader.worker import serve, SchemaCache, DEFAULT_CACHE_CELLS
+from structureReader.writer import DEFAULT_WRITE_BUFFERS
+from structureReader.partition import PartitionSpec, InvalidPartitioning, load_script_path
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR, MEGABYTE
+from contextlib import redirect_stdout
+from typing import TextIO
+import os
+import random
+import sys
 
-def main():
+def main(argv: list[str] | None = None, schemas: SchemaCache | None = None):
     import argparse
     parser = argparse.ArgumentParser(description="Generate SQL and CSV from JSON Schema")
-    parser.add_argument("-f", "--file", help="JSON Schema file", required=True)
+    parser.add_argument("-f", "--file", help="JSON Schema file")
     parser.add_argument("-c", "--csv", help="Generate CSV", action="store_true")
     parser.add_argument("-s", "--sql", help="Generate SQL", action="store_true")
-    parser.add_argument("-d", "--dialect", help="SQL dialect (supported are oracle and postgres)", default="postgres")
-    args = parser.parse_args()
-    VALID_DIALECTS = ["oracle", "postgres"]
-    if args.sql and not args.dialect in VALID_DIALECTS:
-        print(f"Invalid dialect {args.dialect} valid dialects are {', '.join(VALID_DIALECTS)}")
+    parser.add_argument("-d", "--dialect", help="SQL dialect (supported are oracle and postgres)", default=None)
+    parser.add_argument("--scale-factor", help="Multiplies the row count of every table according to its scaling rule (overrides the schema's scale_factor)", type=float, default=None)
+    parser.add_argument("--seed", help="Seed for the generated data, the same seed and schema always generate the same data", type=int, default=None)
+    parser.add_argument("-p", "--profile", help="Print per-stage timings and write <schema>.profile.json and <schema>.trace.json", action="store_true")
+    parser.add_argument("--trace", help="Chrome trace-event output file (implies --profile)", default=None)
+    parser.add_argument("--profile-allocations", help="Also track allocated bytes per stage (slow)", action="store_true")
+    parser.add_argument("--shard-index", help="Generate only the slice of every table belonging to this shard", type=int, default=None)
+    parser.add_argument("--shard-count", help="Total number of shards", type=int, default=None)
+    parser.add_argument("--shard-dir", help="Directory for shard part files and manifests (default <schema>_shards)", default=None)
+    parser.add_argument("--local-shards", help="Run N shards as local processes and merge them", type=int, default=None)
+    parser.add_argument("--merge", help="Verify and merge the shards in the given directory", metavar="DIR", default=None)
+    parser.add_argument("--verify", help="Only verify the shards in the given directory", metavar="DIR", default=None)
+    parser.add_argument("--resume", help="Resume an interrupted run from its last checkpoint", action="store_true")
+    parser.add_argument("--checkpoint", help="Write checkpoints while generating, so that an interrupted run can be continued with --resume", action="store_true")
+    parser.add_argument("--checkpoint-interval", help="Number of 4096 rows chunks written between checkpoints (default 16)", type=int, default=16)
+    parser.add_argument("--sort-by-primary-key", help="Write the rows of every table ordered by its primary keys and create the primary keys after the data", action="store_true", default=None)
+    parser.add_argument("--sort-workers", help="Processes sorting runs in parallel when sorting by primary key (default: number of CPUs)", type=int, default=None)
+    parser.add_argument("--write-buffers", help=f"Batches queued per output file for its background writer, 0 writes synchronously (default {DEFAULT_WRITE_BUFFERS})", type=int, default=DEFAULT_WRITE_BUFFERS)
+    parser.add_argument("--parts", help="Split the output of every table into N part files and write a script loading them in parallel", metavar="N", type=int, default=None)
+    parser.add_argument("--part-rows", help="Split the output of every table into part files of at most N rows", metavar="N", type=int, default=None)
+    parser.add_argument("--part-size", help="Split the output of every table into part files of at most MB megabytes", metavar="MB", type=float, default=None)
+    parser.add_argument("--memory-limit", help="Keep the memory use of the run under MB megabytes by generating smaller batches and queueing less output", metavar="MB", type=float, default=None)
+    parser.add_argument("--statistics", help="Also write the column statistics (<schema>/<table>.stats.json) of the generated tables, which slows generation down", action="store_true")
+    parser.add_argument("--calibrate", help="Measure generator, formatting and disk throughput of this machine and write them to FILE", metavar="FILE", nargs="?", const="calibration.json", default=None)
+    parser.add_argument("--workload", help="Write a stream of N inserts, updates and deletes which follows the initial load", metavar="N", type=int, default=None)
+    parser.add_argument("--workload-mix", help="Relative weights of the workload operations (default insert=40,update=50,delete=10)", default="insert=40,update=50,delete=10")
+    parser.add_argument("--workload-skew", help="Skew of updated and deleted rows towards the most recent ones, in [0, 1) (default 0, uniform)", type=float, default=0.0)
+    parser.add_argument("--workload-output", help="Workload output file, - for stdout (default <schema>.workload.sql)", default=None)
+    parser.add_argument("--tables", help="Comma separated tables to generate (default: the tables of the schema not marked \"generate\": false), the tables they reference only provide the sampled keys", default=None)
+    parser.add_argument("--worker", help="Serve framed requests on stdin/stdout, keeping schemas and generated data loaded between them", action="store_true")
+    parser.add_argument("--worker-cache-cells", help=f"Generated values (rows * columns) a worker keeps between requests (default {DEFAULT_CACHE_CELLS})", type=int, default=DEFAULT_CACHE_CELLS)
+    args = parser.parse_args(argv)
+    if args.worker:
+        if schemas is not None:
+            parser.error("--worker cannot be used in a worker request")
+        serve(main, args.worker_cache_cells)
+        return
+    if args.workload_output == "-":
+        # the workload is written to stdout, so everything else the run prints goes to stderr
+        workload_out = sys.stdout
+        with redirect_stdout(sys.stderr):
+            return run(args, parser, schemas, workload_out)
+    return run(args, parser, schemas, None)
+
+
+def run(args, parser, schemas: SchemaCache | None, workload_out: TextIO | None) -> int | None:
+    profiling = args.profile or args.trace is not None or args.profile_allocations
+    if profiling:
+        PROFILER.enable(track_allocations=args.profile_allocations)
+    if args.calibrate:
+        calibrate(args.calibrate)
+        print(f"Calibration written to {args.calibrate}")
+        return
+    if args.merge or args.verify:
+        try:
+            if args.verify:
+                manifests = verify_shards(args.verify)
+                print(f"{len(manifests)} shard(s) in {args.verify} are complete and valid")
+            else:
+                merge_shards(args.merge)
+                print(f"Shards in {args.merge} were merged")
+        except (InvalidShards, OSError) as exc:
+            print(f"{exc}")
+            return 1
         return
-    if args.dialect in VALID_DIALECTS and not args.sql:
+    if args.file is None:
+        parser.error("the following arguments are required: -f/--file")
+    VALID_DIALECTS = ["oracle", "postgres"]
+    if args.dialect is not None and not args.sql and args.workload is None:
         print(f"Cannot specify dialect without sql generation")
         return
+    if args.dialect is None:
+        args.dialect = "postgres"
+    if (args.sql or args.workload is not None) and not args.dialect in VALID_DIALECTS:
+        print(f"Invalid dialect {args.dialect} valid dialects are {', '.join(VALID_DIALECTS)}")
+        return
+    mix = None
+    if args.workload is not None:
+        try:
+            mix = parse_mix(args.workload_mix)
+        except InvalidWorkload as exc:
+            print(f"{exc}")
+            return 1
+        if args.workload < 0:
+            print(f"--workload must not be negative")
+            return 1
+    if args.memory_limit is not None and args.memory_limit <= 0:
+        print(f"--memory-limit must be positive")
+        return 1
+    GOVERNOR.configure(int(args.memory_limit * MEGABYTE) if args.memory_limit is not None else None)
+    partitioning = None
+    if args.parts is not None or args.part_rows is not None or args.part_size is not None:
+        try:
+            partitioning = PartitionSpec(args.parts, args.part_rows, args.part_size)
+        except InvalidPartitioning as exc:
+            print(f"{exc}")
+            return 1
+    sharded = args.shard_index is not None or args.shard_count is not None
+    if sharded and (args.shard_index is None or args.shard_count is None or args.seed is None):
+        print(f"--shard-index, --shard-count and --seed must all be given to generate a shard")
+        return 1
+    seed = args.seed
+    if args.resume and seed is None:
+        # an interrupted run can only be continued with the seed it was started with
+        schema_name = os.path.splitext(os.path.basename(args.file))[0]
+        for path in (os.path.join(schema_name, ".checkpoint.json"), f"{schema_name}.sql.checkpoint.json"):
+            if (seed := Checkpoint.peek_seed(path)) is not None:
+                break
+    if seed is None and schemas is None:
+        seed = random.SystemRandom().getrandbits(63)
     try:
-        schema = parse_json_schema(args.file)
+        if schemas is not None:
+            # a worker reuses the schema (and its seed when none is given) of earlier requests
+            schema = schemas.load(args.file, seed, args.scale_factor, args.sort_by_primary_key)
+        else:
+            schema = parse_json_schema(args.file, seed, args.scale_factor, args.sort_by_primary_key)
     except Exception as exc:
         print(f"{exc}")
-        return
+        return 1
+    try:
+        return generate(args, schema, partitioning, mix, sharded, profiling, workload_out)
+    finally:
+        # the schemas of a worker, and their spilled key columns, are kept for the next request
+        if schemas is None:
+            schema.close()
+
+
+def generate(args, schema: DbSchema, partitioning: PartitionSpec | None, mix: dict[str, float] | None, sharded: bool, profiling: bool, workload_out: TextIO | None) -> int | None:
+    tables = [name.strip() for name in args.tables.split(",") if name.strip()] if args.tables is not None else None
+    try:
+        schema.select_tables(tables)
+    except InvalidSchema as exc:
+        print(f"{exc}")
+        return 1
+    # a resumed run goes on checkpointing
+    schema.configure_checkpoints(args.checkpoint or args.resume, args.checkpoint_interval)
+    schema.configure_sorting(args.sort_workers)
+    schema.configure_writes(args.write_buffers)
+    schema.configure_partitioning(partitioning)
+    schema.configure_statistics(args.statistics)
     print(f"Schema {args.file} was valid")
-    if args.csv:
-        schema.generate_csv()
-    if args.sql:
-        schema.generate_sql(args.dialect)
+    print(f"Using seed {schema.seed}")
+    if schema.scale_factor != 1:
+        print(f"Using scale factor {schema.scale_factor}: " + ", ".join(f"{table._name} {table._quantity} rows" for table in schema._tables))
+    if len(schema.selected_tables) < len(schema._tables):
+        print(f"Generating tables " + ", ".join(table._name for table in schema.selected_tables))
+        if sources := schema.key_source_tables():
+            print(f"Sampling keys from " + ", ".join(table._name for table in sources))
+    if schema.sort_by_primary_key and (sharded or args.local_shards):
+        print(f"Sorting by primary key cannot be combined with sharded generation")
+        return 1
+    if partitioning and (sharded or args.local_shards):
+        print(f"Part files cannot be combined with sharded generation")
+        return 1
+    shard_dir = args.shard_dir if args.shard_dir else f"{schema._name}_shards"
+    if args.local_shards:
+        try:
+            run_local_shards(os.path.abspath(__file__), args.file, args.local_shards, shard_dir, schema.seed, schema.scale_factor, args.csv, args.dialect if args.sql else None, tables, args.memory_limit, args.statistics)
+            merge_shards(shard_dir)
+        except (InvalidShards, OSError) as exc:
+            print(f"{exc}")
+            return 1
+        print(f"{args.local_shards} shards were generated in {shard_dir} and merged")
+    elif sharded:
+        try:
+            generate_shard(schema, args.shard_index, args.shard_count, shard_dir, args.csv, args.dialect if args.sql else None)
+        except (InvalidShards, OSError) as exc:
+            print(f"{exc}")
+            return 1
+        print(f"Shard {args.shard_index}/{args.shard_count} was written to {shard_dir}")
+    elif args.csv or args.sql:
+        resume_csv = args.resume and os.path.exists(schema.csv_checkpoint_path())
+        resume_sql = args.resume and os.path.exists(schema.sql_checkpoint_path())
+        if args.resume and not resume_csv and not resume_sql:
+            print(f"No checkpoint of {schema._name} was found, generating everything")
+        try:
+            # with both formats every batch is generated once and written to both
+            schema.generate(args.csv, args.dialect if args.sql else None,
+                            resume_csv=resume_csv, resume_sql=resume_sql)
+        except (CheckpointMismatch, InvalidPartitioning) as exc:
+            print(f"{exc}")
+            return 1
+        if partitioning:
+            for extension in (["csv"] if args.csv else []) + (["sql"] if args.sql else []):
+                print(f"Parts were written to {schema._name}, {load_script_path(schema._name, extension)} loads them")
+    if args.workload is not None:
+        output = args.workload_output if args.workload_output else f"{schema._name}.workload.sql"
+        try:
+            if workload_out is not None:
+                generate_workload(schema, args.dialect, args.workload, mix, args.workload_skew, workload_out)
+                workload_out.flush()
+                output = "stdout"
+            else:
+                with open(output, "w") as f:
+                    generate_workload(schema, args.dialect, args.workload, mix, args.workload_skew, f)
+            print(f"Workload of {args.workload} operations was written to {output}")
+        except (InvalidWorkload, OSError) as exc:
+            print(f"{exc}")
+            return 1
+    if args.memory_limit is not None or profiling:
+        print(GOVERNOR.report())
+    if profiling:
+        print(PROFILER.format_summary())
+        PROFILER.write_summary(f"{schema._name}.profile.json")
+        PROFILER.write_chrome_trace(args.trace if args.trace else f"{schema._name}.trace.json")
 
 
 if __name__ == "__main__":
-    main()
+    sys.exit(main())
 else:
-    __all__ = ["parse_json_schema", "InvalidSchema"]
\ No newline at end of file
+    __all__ = ["parse_json_schema", "InvalidSchema"]
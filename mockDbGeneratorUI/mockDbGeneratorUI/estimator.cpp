@@ -0,0 +1,328 @@
+#include "estimator.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QSet>
+#include <cmath>
+#include <algorithm>
+#ifdef Q_OS_WIN
+// keeps windows.h from defining min and max macros, which break std::min and std::max
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// rows generated at once by the python side (DEFAULT_BATCH_CHUNKS * CHUNK_ROWS)
+static constexpr qint64 BATCH_ROWS = 16 * 4096;
+static constexpr int MAX_REFERENCE_DEPTH = 16;
+
+// average number of characters of the integers in [lo, hi]
+static double average_digits(double lo, double hi) {
+    if (hi < lo) {
+        std::swap(lo, hi);
+    }
+    if (lo < 0 && hi <= 0) {
+        return 1.0 + average_digits(-hi, -lo);
+    }
+    if (lo < 0) {
+        double neg = -lo, pos = hi + 1;
+        return (neg * (1.0 + average_digits(1, -lo)) + pos * average_digits(0, hi)) / (neg + pos);
+    }
+    double total = 0.0;
+    double start = lo;
+    int digits = start < 10 ? 1 : static_cast<int>(std::floor(std::log10(start))) + 1;
+    while (start <= hi) {
+        double decade_end = std::min(hi, std::pow(10.0, digits) - 1);
+        total += (decade_end - start + 1) * digits;
+        start = decade_end + 1;
+        ++digits;
+    }
+    return total / (hi - lo + 1);
+}
+
+static QJsonObject find_attribute(const QJsonObject& table, const QString& name) {
+    for (const auto& jattr : table["attributes"].toArray()) {
+        if (jattr["name"].toString() == name) {
+            return jattr.toObject();
+        }
+    }
+    return {};
+}
+
+// follows foreign keys to the attribute which actually generates the values
+static QJsonObject resolve_attribute(const QJsonObject& attr, const QHash<QString, QJsonObject>& tables, QString* table_name = nullptr) {
+    QJsonObject current = attr;
+    for (int depth = 0; depth < MAX_REFERENCE_DEPTH && current["type"].toString().toUpper() == "FOREIGN_KEY"; ++depth) {
+        const auto& refs = current["references"].toObject();
+        auto it = tables.find(refs["table"].toString());
+        if (it == tables.end()) {
+            return {};
+        }
+        if (table_name) {
+            *table_name = it.key();
+        }
+        current = find_attribute(*it, refs["attribute"].toString());
+    }
+    return current;
+}
+
+static qint64 rows_of(const QJsonObject& table) {
+    const auto& jrows = table["rows"];
+    return jrows.isDouble() ? static_cast<qint64>(jrows.toDouble()) : jrows.toString().toLongLong();
+}
+
+static double number_of(const QJsonValue& value, double fallback) {
+    if (value.isDouble()) {
+        return value.toDouble();
+    }
+    bool ok = false;
+    double v = value.toString().toDouble(&ok);
+    return ok ? v : fallback;
+}
+
+bool Estimator::load_calibration(const QString& filename) {
+    QFile file{filename};
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_calibrated = false;
+        return false;
+    }
+    m_calibration = QJsonDocument::fromJson(file.readAll()).object();
+    m_calibrated = !m_calibration.isEmpty();
+    return m_calibrated;
+}
+
+double Estimator::calibration_value(const QString& key, double fallback) const {
+    const auto& value = m_calibration[key];
+    return value.isDouble() && value.toDouble() > 0 ? value.toDouble() : fallback;
+}
+
+double Estimator::generator_rate(const QString& key) const {
+    const auto& value = m_calibration["generator_rows_per_second"][key];
+    return value.isDouble() && value.toDouble() > 0 ? value.toDouble() : 250'000.0;
+}
+
+double Estimator::dictionary_length(const QString& key, double fallback) const {
+    const auto& value = m_calibration["dictionaries"][key];
+    return value.isDouble() ? value.toDouble() : fallback;
+}
+
+double Estimator::value_width(const QJsonObject& attr, qint64 rows) const {
+    const auto type = attr["type"].toString().toUpper();
+    const auto generation = attr["generation"].toString("random").toUpper();
+    if (generation == "EXPRESSION") {
+        // the values depend on the expression, assume typical widths
+        if (type == "STRING") {
+            return number_of(attr["length"], 16);
+        }
+        return type == "DATE" ? 19 : type == "REAL" ? 18 : 6;
+    }
+    if (generation == "ENUM" && attr["values"].isArray()) {
+        // the average of the values as printed, weighted like they are drawn
+        const auto values = attr["values"].toArray();
+        const auto weights = attr["weights"].toArray();
+        double total = 0;
+        double width = 0;
+        for (qsizetype i = 0; i < values.size(); ++i) {
+            const double weight = i < weights.size() ? number_of(weights[i], 1) : 1;
+            const auto& value = values[i];
+            const double length = type == "DATE" ? 19 : value.isDouble() ? QString::number(value.toDouble()).size() : value.toString().size();
+            width += weight * length;
+            total += weight;
+        }
+        return total > 0 ? width / total : 6;
+    }
+    if (type == "STRING") {
+        const double length = number_of(attr["length"], 10);
+        if (generation == "NAMESURNAME") {
+            return dictionary_length("name", 6) + 1 + dictionary_length("surname", 6);
+        } else if (generation == "EMAIL") {
+            return dictionary_length("name", 6) + 1 + dictionary_length("surname", 6) + 1 + dictionary_length("email_domain", 10);
+        } else if (generation == "PHONE") {
+            return 10;
+        } else if (generation == "NATURALTEXT") {
+            return length * (dictionary_length("word", 8) + 1) - 1;
+        }
+        return length;
+    } else if (type == "DATE") {
+        // microseconds are only printed when they are not 0
+        const auto& step = attr["step"].toObject();
+        const bool sub_second = number_of(step["microseconds"], 0) != 0 || number_of(step["milliseconds"], 0) != 0;
+        return sub_second && generation != "RANDOM" ? 26 : 19;
+    }
+    const double start = number_of(attr["start"], 0);
+    const double step = number_of(attr["step"], 1);
+    double width = 0;
+    const auto& distribution = attr["distribution"];
+    if (generation == "RANDOM" && (distribution.isObject() || distribution.isString())) {
+        if (type == "REAL") {
+            return 18;
+        }
+        // integers stay within min and max when both are given, zipf ranks go up to n
+        const auto kind = (distribution.isString() ? distribution.toString() : distribution["type"].toString()).toLower();
+        if (distribution["min"].isDouble() && distribution["max"].isDouble()) {
+            return average_digits(distribution["min"].toDouble(), distribution["max"].toDouble());
+        } else if (kind == "zipf") {
+            // most values are small ranks
+            return std::min(average_digits(1, number_of(distribution["n"], step)), 3.0);
+        } else if (kind == "uniform") {
+            return average_digits(number_of(distribution["low"], 0), number_of(distribution["high"], step));
+        }
+        return 6;
+    }
+    if (generation == "INCREASING") {
+        width = average_digits(start, start + step * std::max<qint64>(rows - 1, 0));
+    } else if (generation == "DECREASING") {
+        width = average_digits(start - step * std::max<qint64>(rows - 1, 0), start);
+    } else if (generation == "REPEATING") {
+        width = average_digits(0, std::max(step - 1, 0.0));
+    } else if (type == "REAL") {
+        // random reals are printed with all their significant digits
+        return 18;
+    } else {
+        width = average_digits(0, step);
+    }
+    // python prints integral floats as "n.0"
+    return type == "REAL" ? width + 2 : width;
+}
+
+qint64 Estimator::value_memory(const QJsonObject& attr, double width) const {
+    // list slot + object header, as measured on 64 bit CPython
+    const auto type = attr["type"].toString().toUpper();
+    if (type == "STRING") {
+        return 8 + 49 + static_cast<qint64>(width);
+    } else if (type == "DATE") {
+        return 8 + 48;
+    } else if (type == "REAL") {
+        return 8 + 24;
+    }
+    return 8 + 28;
+}
+
+qint64 Estimator::scaled_rows(const QJsonObject& table, const QHash<QString, QJsonObject>& tables, double scale_factor, int depth) const {
+    const qint64 rows = rows_of(table);
+    const auto& jscaling = table["scaling"];
+    const auto mode = (jscaling.isString() ? jscaling.toString() : jscaling["mode"].toString("linear")).toUpper();
+    if (mode == "FIXED") {
+        return rows;
+    } else if (mode == "PROPORTIONAL" && depth < MAX_REFERENCE_DEPTH) {
+        auto it = tables.find(jscaling["table"].toString());
+        if (it == tables.end()) {
+            return rows;
+        }
+        const qint64 parent_rows = rows_of(*it);
+        const double ratio = number_of(jscaling["ratio"], parent_rows ? static_cast<double>(rows) / parent_rows : 0.0);
+        return std::llround(scaled_rows(*it, tables, scale_factor, depth + 1) * ratio);
+    }
+    qint64 scaled = std::llround(rows * scale_factor);
+    return rows > 0 && scale_factor > 0 ? std::max<qint64>(scaled, 1) : scaled;
+}
+
+QVector<TableEstimate> Estimator::estimate(const QJsonObject& schema, bool oracle) const {
+    static const QString oracle_date_prefix{"TO_TIMESTAMP('"};
+    static const QString oracle_date_suffix{"', 'YYYY-MM-DD HH24:MI:SS')"};
+    const double scale_factor = number_of(schema["scale_factor"], 1.0);
+    const bool sorted = schema["sort_by_primary_key"].toBool(false);
+    const double csv_rate = calibration_value("csv_bytes_per_second", 5e6);
+    const double sql_rate = calibration_value("sql_bytes_per_second", 8e6);
+    const double disk_rate = calibration_value("disk_bytes_per_second", 2e8);
+    QHash<QString, QJsonObject> tables{};
+    QHash<QString, qint64> rows{};
+    for (const auto& jtbl : schema["tables"].toArray()) {
+        tables.insert(jtbl["name"].toString(), jtbl.toObject());
+    }
+    for (auto it = tables.cbegin(); it != tables.cend(); ++it) {
+        rows.insert(it.key(), scaled_rows(*it, tables, scale_factor));
+    }
+    QVector<TableEstimate> estimates{};
+    QSet<QString> spilled_keys{};
+    for (const auto& jtbl : schema["tables"].toArray()) {
+        const auto& table = jtbl.toObject();
+        if (!table["generate"].toBool(true)) {
+            // only the keys sampled by generated tables are produced, they are counted with those
+            continue;
+        }
+        TableEstimate est{};
+        est.name = table["name"].toString();
+        est.rows = rows.value(est.name);
+        const auto& attributes = table["attributes"].toArray();
+        double csv_row = 2;     // \r\n
+        double sql_row = QString{"INSERT INTO %1() VALUES ();\n"}.arg(est.name).size();
+        double csv_header = 2;
+        double generation_seconds = 0;
+        double batch_memory = 0;
+        for (const auto& jattr : attributes) {
+            const auto& attr = jattr.toObject();
+            const auto name = attr["name"].toString();
+            QString ref_table = est.name;
+            const auto source = resolve_attribute(attr, tables, &ref_table);
+            const bool is_fk = attr["type"].toString().toUpper() == "FOREIGN_KEY";
+            // event timestamps of a time series carry their microseconds
+            const bool is_event_time = table["time_series"]["timestamp"].toString() == name;
+            const double width = is_event_time ? 26 : value_width(source, rows.value(ref_table));
+            const auto type = source["type"].toString().toUpper();
+            // NULLs are empty in csv and NULL in sql
+            const double nulls = std::clamp(number_of(attr["null_fraction"], 0), 0.0, 1.0);
+            csv_row += width * (1 - nulls);
+            csv_header += name.size();
+            sql_row += name.size() + width * (1 - nulls) + 4 * nulls;
+            if (type == "STRING") {
+                sql_row += 2 * (1 - nulls);
+            } else if (type == "DATE") {
+                sql_row += (oracle ? oracle_date_prefix.size() + oracle_date_suffix.size() : 2) * (1 - nulls);
+            }
+            batch_memory += value_memory(source, width);
+            if (is_fk) {
+                // the whole referenced column is spilled to a memory mapped file while the parent is generated
+                const qint64 parent_rows = rows.value(ref_table);
+                generation_seconds += est.rows / generator_rate("FOREIGN_KEY");
+                const QString key = ref_table + "." + source["name"].toString();
+                if (!spilled_keys.contains(key)) {
+                    spilled_keys.insert(key);
+                    // fixed 8 bytes per key, strings also need their text
+                    est.temp_bytes += static_cast<qint64>(parent_rows * (type == "STRING" ? 8 + width : 8));
+                }
+            } else {
+                generation_seconds += est.rows / generator_rate(type + "." + attr["generation"].toString("random").toUpper());
+            }
+        }
+        if (!attributes.isEmpty()) {
+            // separators: "," in csv, ", " in both lists of the insert
+            csv_row += attributes.size() - 1;
+            csv_header += attributes.size() - 1;
+            sql_row += 4.0 * (attributes.size() - 1);
+        }
+        est.csv_bytes = static_cast<qint64>(csv_header + csv_row * est.rows);
+        est.sql_bytes = static_cast<qint64>(sql_row * est.rows);
+        est.csv_seconds = generation_seconds + est.csv_bytes / csv_rate + est.csv_bytes / disk_rate;
+        est.sql_seconds = generation_seconds + est.sql_bytes / sql_rate + est.sql_bytes / disk_rate;
+        est.memory_bytes += static_cast<qint64>(batch_memory * std::min(est.rows, BATCH_ROWS));
+        if (sorted && !table["primary_keys"].toArray().isEmpty()) {
+            // the sorted runs hold every formatted row until they are merged
+            est.temp_bytes += std::max(est.csv_bytes, est.sql_bytes);
+        }
+        estimates.append(est);
+    }
+    return estimates;
+}
+
+qint64 Estimator::available_memory() {
+#ifdef Q_OS_WIN
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) {
+        return -1;
+    }
+    return static_cast<qint64>(status.ullAvailPhys);
+#elif defined(_SC_AVPHYS_PAGES)
+    const long pages = sysconf(_SC_AVPHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (pages < 0 || page_size < 0) {
+        return -1;
+    }
+    return static_cast<qint64>(pages) * page_size;
+#else
+    // macOS has no _SC_AVPHYS_PAGES, the available memory is unknown there
+    return -1;
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QJsonObject>
+
+struct TableEstimate {
+    QString name;
+    qint64 rows{};
+    qint64 csv_bytes{};
+    qint64 sql_bytes{};
+    double csv_seconds{};
+    double sql_seconds{};
+    // python objects kept alive for the rows of one batch
+    qint64 memory_bytes{};
+    // temporary files: key columns referenced by this table's foreign keys and sorted runs
+    qint64 temp_bytes{};
+};
+
+// Predicts output sizes and run times of a schema (as produced by MainWindow::schema_json)
+// from the throughputs measured by `mockDbGenerator.py --calibrate`.
+class Estimator
+{
+    QJsonObject m_calibration{};
+    bool m_calibrated{false};
+
+    double generator_rate(const QString& key) const;
+    double calibration_value(const QString& key, double fallback) const;
+    double dictionary_length(const QString& key, double fallback) const;
+    double value_width(const QJsonObject& attr, qint64 rows) const;
+    qint64 value_memory(const QJsonObject& attr, double width) const;
+    qint64 scaled_rows(const QJsonObject& table, const QHash<QString, QJsonObject>& tables, double scale_factor, int depth = 0) const;
+public:
+    bool load_calibration(const QString& filename);
+    bool calibrated() const { return m_calibrated; }
+    QVector<TableEstimate> estimate(const QJsonObject& schema, bool oracle) const;
+    // physical memory available to new processes in bytes, -1 when it is unknown
+    static qint64 available_memory();
+};
+
+#endif // ESTIMATOR_H
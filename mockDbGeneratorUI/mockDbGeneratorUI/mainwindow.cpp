@@ -9,6 +9,15 @@
 #include <QProcess>
 #include <QStringView>
 #include <QMessageBox>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QDoubleValidator>
+#include <QIntValidator>
+#include <QGroupBox>
+#include <QLocale>
+#include <QStorageInfo>
+#include <QtEndian>
 #include <utility>
 #include <array>
 #include <algorithm>
@@ -19,6 +28,7 @@ static void unpack_python_script() {
 #define DG "dataGenerators/"
 #define SR "structureReader/"
 #define TW "typeWrappers/"
+#define IN "instrumentation/"
 #define DT "data/"
 #define MAKE_RC(name, fold) std::pair{QString{RC fold name}, QString{fold name}}
     std::array names{
@@ -27,8 +37,25 @@ static void unpack_python_script() {
         MAKE_RC("__init__.py", SR),
         MAKE_RC("__init__.py", TW),
         MAKE_RC("generators.py", DG),
+        MAKE_RC("expression.py", DG),
+        MAKE_RC("distributions.py", DG),
+        MAKE_RC("dictionary.py", DG),
+        MAKE_RC("timeseries.py", DG),
         MAKE_RC("reader.py", SR),
+        MAKE_RC("shard.py", SR),
+        MAKE_RC("checkpoint.py", SR),
+        MAKE_RC("keystore.py", SR),
+        MAKE_RC("sort.py", SR),
+        MAKE_RC("workload.py", SR),
+        MAKE_RC("worker.py", SR),
+        MAKE_RC("writer.py", SR),
+        MAKE_RC("partition.py", SR),
+        MAKE_RC("columnstats.py", SR),
+        MAKE_RC("calibration.py", SR),
         MAKE_RC("types.py", TW),
+        MAKE_RC("__init__.py", IN),
+        MAKE_RC("profiler.py", IN),
+        MAKE_RC("memory.py", IN),
         MAKE_RC("female-names-list.txt", DT),
         MAKE_RC("male-names-list.txt", DT),
         MAKE_RC("surnames-list.txt", DT),
@@ -38,6 +65,7 @@ static void unpack_python_script() {
         "dataGenerators",
         "structureReader",
         "typeWrappers",
+        "instrumentation",
         "data"
     };
 #undef RC
@@ -45,6 +73,7 @@ static void unpack_python_script() {
 #undef DG
 #undef SR
 #undef TW
+#undef IN
 #undef DT
 #undef MAKE_RC
     QDir d;
@@ -83,22 +112,46 @@ MainWindow::MainWindow(QWidget *parent)
     mainWindow->setLayout(layout);
     setCentralWidget(mainWindow);
     m_schema_name = new QLineEdit{"schema_name", dumpWidget};
+    QLabel* scaleLabel = new QLabel{"Scale factor:", dumpWidget};
+    m_scale_factor = new QLineEdit{"1", dumpWidget};
+    m_scale_factor->setValidator(new QDoubleValidator{0.0, 1e9, 6, m_scale_factor});
+    QLabel* memoryLabel = new QLabel{"Memory limit (MB):", dumpWidget};
+    m_memory_limit = new QLineEdit{dumpWidget};
+    m_memory_limit->setValidator(new QIntValidator{1, 1 << 30, m_memory_limit});
+    m_memory_limit->setPlaceholderText("no limit");
+    m_memory_limit->setToolTip("Generate smaller batches and queue less output to stay under this much memory");
+    m_sort_by_pk = new QCheckBox{"Sort by primary key", dumpWidget};
+    m_sort_by_pk->setToolTip("Write rows ordered by primary key and create the primary keys after loading the data");
+    m_profile = new QCheckBox{"Profile", dumpWidget};
+    m_profile->setToolTip("Time every stage of the run, the timings are shown by \"Diagnostics\"");
+    m_statistics = new QCheckBox{"Statistics", dumpWidget};
+    m_statistics->setToolTip("Write the column statistics of every table to <schema>/<table>.stats.json (slows generation down)");
     QPushButton* btn1 = new QPushButton{dumpWidget};
     QPushButton* btn2 = new QPushButton{dumpWidget};
     QPushButton* btn3 = new QPushButton{dumpWidget};
     QPushButton* btn4 = new QPushButton{dumpWidget};
     QPushButton* btn5 = new QPushButton{dumpWidget};
+    QPushButton* btn6 = new QPushButton{dumpWidget};
     btn1->setText("Add table");
     btn2->setText("Dump to json");
     btn3->setText("Generate data (csv)");
     btn4->setText("Generate data (sql)");
     btn5->setText("Import from JSON");
+    btn6->setText("Diagnostics");
     dumpLayout->addWidget(m_schema_name);
+    dumpLayout->addWidget(scaleLabel);
+    dumpLayout->addWidget(m_scale_factor);
+    dumpLayout->addWidget(memoryLabel);
+    dumpLayout->addWidget(m_memory_limit);
+    dumpLayout->addWidget(m_sort_by_pk);
+    dumpLayout->addWidget(m_profile);
+    dumpLayout->addWidget(m_statistics);
     dumpLayout->addWidget(btn1);
     dumpLayout->addWidget(btn2);
     dumpLayout->addWidget(btn3);
     dumpLayout->addWidget(btn4);
     dumpLayout->addWidget(btn5);
+    dumpLayout->addWidget(btn6);
     QObject::connect(btn1, &QPushButton::clicked, this, [this](int){
         add_table();
     });
@@ -114,7 +167,285 @@ MainWindow::MainWindow(QWidget *parent)
     QObject::connect(btn5, &QPushButton::clicked, this, [this](int){
         import_json();
     });
+    QObject::connect(btn6, &QPushButton::clicked, this, [this](int){
+        show_diagnostics();
+    });
     layout->addWidget(dumpWidget);
+
+    // estimate of the output of the current schema, refreshed shortly after any edit
+    QGroupBox* estimateBox = new QGroupBox{"Estimate", mainWindow};
+    QVBoxLayout* estimateLayout = new QVBoxLayout;
+    estimateBox->setLayout(estimateLayout);
+    const std::array<QString, 7> estimateColumns{
+        "Table", "Rows", "CSV size", "SQL size", "CSV time", "SQL time", "Memory"
+    };
+    m_estimate_table = new QTableWidget{0, static_cast<int>(estimateColumns.size()), estimateBox};
+    for (int col = 0; col < static_cast<int>(estimateColumns.size()); ++col) {
+        m_estimate_table->setHorizontalHeaderItem(col, new QTableWidgetItem{estimateColumns[col]});
+    }
+    m_estimate_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_estimate_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_estimate_table->setMaximumHeight(150);
+    QWidget* estimateFooter = new QWidget{estimateBox};
+    QHBoxLayout* estimateFooterLayout = new QHBoxLayout;
+    estimateFooter->setLayout(estimateFooterLayout);
+    m_estimate_total = new QLabel{estimateFooter};
+    QPushButton* calibrateBtn = new QPushButton{"Recalibrate", estimateFooter};
+    estimateFooterLayout->addWidget(m_estimate_total, 1);
+    estimateFooterLayout->addWidget(calibrateBtn);
+    estimateLayout->addWidget(m_estimate_table);
+    estimateLayout->addWidget(estimateFooter);
+    layout->addWidget(estimateBox);
+    m_estimate_timer = new QTimer{this};
+    m_estimate_timer->setSingleShot(true);
+    m_estimate_timer->setInterval(250);
+    QObject::connect(m_estimate_timer, &QTimer::timeout, this, [this](){
+        update_estimate();
+    });
+    QObject::connect(calibrateBtn, &QPushButton::clicked, this, [this](bool){
+        calibrate();
+    });
+    QObject::connect(m_scale_factor, &QLineEdit::textChanged, this, [this](const QString&){
+        schedule_estimate();
+    });
+    QObject::connect(m_sort_by_pk, &QCheckBox::toggled, this, [this](bool){
+        schedule_estimate();
+    });
+    const bool calibrated = m_estimator.load_calibration("calibration.json");
+    update_estimate();
+    if (!calibrated) {
+        calibrate();
+    }
+}
+
+static QString format_duration(double seconds) {
+    if (seconds < 1) {
+        return QString::asprintf("%.0f ms", seconds * 1000);
+    } else if (seconds < 120) {
+        return QString::asprintf("%.1f s", seconds);
+    } else if (seconds < 7200) {
+        return QString::asprintf("%.1f min", seconds / 60);
+    }
+    return QString::asprintf("%.1f h", seconds / 3600);
+}
+
+void MainWindow::schedule_estimate() {
+    m_estimate_timer->start();
+}
+
+void MainWindow::update_estimate() {
+    const auto estimates = m_estimator.estimate(schema_json(), false);
+    QLocale locale{};
+    m_estimate_table->setRowCount(static_cast<int>(estimates.size()));
+    TableEstimate total{};
+    int row = 0;
+    for (const auto& est : estimates) {
+        const std::array<QString, 7> cells{
+            est.name,
+            locale.toString(est.rows),
+            locale.formattedDataSize(est.csv_bytes),
+            locale.formattedDataSize(est.sql_bytes),
+            format_duration(est.csv_seconds),
+            format_duration(est.sql_seconds),
+            locale.formattedDataSize(est.memory_bytes)
+        };
+        for (int col = 0; col < static_cast<int>(cells.size()); ++col) {
+            m_estimate_table->setItem(row, col, new QTableWidgetItem{cells[col]});
+        }
+        total.rows += est.rows;
+        total.csv_bytes += est.csv_bytes;
+        total.sql_bytes += est.sql_bytes;
+        total.csv_seconds += est.csv_seconds;
+        total.sql_seconds += est.sql_seconds;
+        total.memory_bytes = std::max(total.memory_bytes, est.memory_bytes);
+        ++row;
+    }
+    m_estimate_total->setText(QString{"Total: %1 rows, CSV %2 in %3, SQL %4 in %5%6"}
+                                  .arg(locale.toString(total.rows),
+                                       locale.formattedDataSize(total.csv_bytes),
+                                       format_duration(total.csv_seconds),
+                                       locale.formattedDataSize(total.sql_bytes),
+                                       format_duration(total.sql_seconds),
+                                       m_estimator.calibrated() ? "" : " (not calibrated yet)"));
+}
+
+void MainWindow::calibrate() {
+    QProcess* proc = new QProcess{this};
+    QObject::connect(proc, &QProcess::finished, this, [this, proc](int, QProcess::ExitStatus){
+        m_estimator.load_calibration("calibration.json");
+        update_estimate();
+        proc->deleteLater();
+    });
+    m_estimate_total->setText("Calibrating...");
+    proc->start("py", QStringList{} << "mockDbGenerator.py" << "--calibrate" << "calibration.json");
+}
+
+bool MainWindow::confirm_run(bool csv, bool oracle) {
+    const auto estimates = m_estimator.estimate(schema_json(), oracle);
+    qint64 bytes = 0;
+    qint64 memory = 0;
+    for (const auto& est : estimates) {
+        bytes += (csv ? est.csv_bytes : est.sql_bytes) + est.temp_bytes;
+        memory = std::max(memory, est.memory_bytes);
+    }
+    QLocale locale{};
+    QStringList warnings{};
+    QStorageInfo storage{QDir::currentPath()};
+    if (storage.isValid() && bytes > storage.bytesAvailable()) {
+        warnings << QString{"The output is estimated at %1 but only %2 are free on %3."}
+                        .arg(locale.formattedDataSize(bytes), locale.formattedDataSize(storage.bytesAvailable()), storage.rootPath());
+    }
+    const qint64 available_memory = Estimator::available_memory();
+    if (available_memory > 0 && memory > available_memory) {
+        warnings << QString{"The generator is estimated to need %1 of memory but only %2 are available."}
+                        .arg(locale.formattedDataSize(memory), locale.formattedDataSize(available_memory));
+    }
+    if (warnings.isEmpty()) {
+        return true;
+    }
+    return QMessageBox::warning(this, "Estimate exceeds available resources", warnings.join("\n") + "\n\nGenerate anyway?",
+                                QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::Yes;
+}
+
+// frames exchanged with the worker: 4 byte big endian length followed by that many bytes of JSON
+static QByteArray make_frame(const QJsonObject& message) {
+    const auto payload = QJsonDocument{message}.toJson(QJsonDocument::Compact);
+    QByteArray frame(4, '\0');
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), frame.data());
+    return frame + payload;
+}
+
+bool MainWindow::start_worker() {
+    if (m_worker && m_worker->state() == QProcess::Running) {
+        return true;
+    }
+    stop_worker();
+    m_worker = new QProcess{this};
+    m_worker_buffer.clear();
+    // the worker's stdout only carries frames, its diagnostics go to stderr
+    QObject::connect(m_worker, &QProcess::readyReadStandardError, this, [this](){
+        qDebug().noquote() << m_worker->readAllStandardError();
+    });
+    // replies are read as they arrive, the window keeps running while the worker generates
+    QObject::connect(m_worker, &QProcess::readyReadStandardOutput, this, [this](){
+        read_worker_output();
+    });
+    QObject::connect(m_worker, &QProcess::finished, this, [this](int, QProcess::ExitStatus){
+        worker_finished();
+    });
+    m_worker->start("py", QStringList{} << "mockDbGenerator.py" << "--worker");
+    if (!m_worker->waitForStarted()) {
+        qDebug() << "Worker failed to start";
+        stop_worker();
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::stop_worker() {
+    if (!m_worker) {
+        return;
+    }
+    // a worker which is stopped answers nothing
+    m_worker->disconnect(this);
+    if (m_worker->state() == QProcess::Running) {
+        m_worker->write(make_frame(QJsonObject{{"exit", true}}));
+        m_worker->closeWriteChannel();
+        if (!m_worker->waitForFinished(3000)) {
+            m_worker->kill();
+            m_worker->waitForFinished();
+        }
+    }
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void MainWindow::run_generator(const QStringList& args, GeneratorCallback done) {
+    // the worker is started on first use and kept running, so dictionaries, parsed schemas and
+    // generated rows are reused by the next request. done is called with the reply once it arrives
+    if (m_request_done) {
+        // the previous run is still going, or the worker stalled
+        if (QMessageBox::question(this, "Generation running", "Data is still being generated. Stop it and start the new run?") != QMessageBox::Yes) {
+            return;
+        }
+        stop_worker();
+        if (m_process) {
+            m_process->disconnect(this);
+            m_process->kill();
+            m_process->deleteLater();
+            m_process = nullptr;
+        }
+        m_request_done = nullptr;
+    }
+    m_request_args = args;
+    m_request_done = std::move(done);
+    m_request_attempts = 0;
+    send_request();
+}
+
+void MainWindow::send_request() {
+    // a worker which died is restarted once, without a worker the request runs in a process of its own
+    if (m_request_attempts++ < 2 && start_worker()) {
+        m_worker->write(make_frame(QJsonObject{{"id", ++m_request_id}, {"args", QJsonArray::fromStringList(m_request_args)}}));
+        return;
+    }
+    run_process();
+}
+
+void MainWindow::read_worker_output() {
+    m_worker_buffer += m_worker->readAllStandardOutput();
+    // a read may hold part of a reply or several of them
+    while (m_worker_buffer.size() >= 4) {
+        const quint32 length = qFromBigEndian<quint32>(m_worker_buffer.constData());
+        if (static_cast<quint32>(m_worker_buffer.size()) - 4 < length) {
+            return;
+        }
+        const auto response = QJsonDocument::fromJson(m_worker_buffer.mid(4, length)).object();
+        m_worker_buffer.remove(0, 4 + length);
+        finish_request(GeneratorResult{response["exit_code"].toInt(), response["output"].toString(), response["error"].toString()});
+    }
+}
+
+void MainWindow::worker_finished() {
+    // the reply may have arrived together with the exit
+    read_worker_output();
+    qDebug() << "Worker exited";
+    // deleted once its signal has been handled
+    m_worker->disconnect(this);
+    m_worker->deleteLater();
+    m_worker = nullptr;
+    if (m_request_done) {
+        send_request();
+    }
+}
+
+void MainWindow::run_process() {
+    m_process = new QProcess{this};
+    QObject::connect(m_process, &QProcess::finished, this, [this](int exit_code, QProcess::ExitStatus){
+        GeneratorResult result{exit_code, m_process->readAllStandardOutput(), m_process->readAllStandardError()};
+        m_process->deleteLater();
+        m_process = nullptr;
+        finish_request(result);
+    });
+    QObject::connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error){
+        if (error != QProcess::FailedToStart) {
+            return;
+        }
+        qDebug() << "Process failed";
+        m_process->deleteLater();
+        m_process = nullptr;
+        finish_request(GeneratorResult{-1, "", "The generator could not be started"});
+    });
+    m_process->start("py", QStringList{"mockDbGenerator.py"} + m_request_args);
+}
+
+void MainWindow::finish_request(const GeneratorResult& result) {
+    // the callback may start the next request
+    auto done = std::move(m_request_done);
+    m_request_done = nullptr;
+    if (done) {
+        done(result);
+    }
 }
 
 MockTable* MainWindow::add_table() {
@@ -125,20 +456,31 @@ MockTable* MainWindow::add_table() {
     QObject::connect(tbl->delete_btn(), &QPushButton::clicked, this, [this, tbl](bool){
         tables.removeOne(tbl);
         delete tbl;
+        schedule_estimate();
     });
+    QObject::connect(tbl, &MockTable::changed, this, [this](){
+        schedule_estimate();
+    });
+    schedule_estimate();
     return tbl;
 }
 
-void MainWindow::dump_to_json() {
-    QString filename = m_schema_name->text() + ".json";
-    QJsonDocument doc{};
+QJsonObject MainWindow::schema_json() const {
     QJsonObject mainObj{};
     QJsonArray tables{};
     for (const auto* tbl : this->tables) {
         tables.append(tbl->to_json());
     }
     mainObj.insert("tables", tables);
-    doc.setObject(mainObj);
+    mainObj.insert("scale_factor", m_scale_factor->text().toDouble());
+    mainObj.insert("sort_by_primary_key", m_sort_by_pk->isChecked());
+    return mainObj;
+}
+
+void MainWindow::dump_to_json() {
+    QString filename = m_schema_name->text() + ".json";
+    QJsonDocument doc{};
+    doc.setObject(schema_json());
     QFile file{filename};
     file.open(QFile::OpenModeFlag::WriteOnly);
     file.write(doc.toJson());
@@ -146,16 +488,25 @@ void MainWindow::dump_to_json() {
 }
 
 void MainWindow::generate_csv() {
+    if (!confirm_run(true, false)) {
+        return;
+    }
     dump_to_json();
-    QProcess proc{};
     QStringList args;
-    args << "mockDbGenerator.py" << "--file" << (m_schema_name->text() + ".json");
+    args << "--file" << (m_schema_name->text() + ".json");
     args << "--csv";
-    proc.start("py", args);
-    if (!proc.waitForFinished()) {
-        qDebug() << "Proces failed";
-    };
-    QMessageBox::information(this, "Command result", proc.readAllStandardOutput());
+    if (m_profile->isChecked()) {
+        args << "--profile";
+    }
+    if (m_statistics->isChecked()) {
+        args << "--statistics";
+    }
+    if (!m_memory_limit->text().isEmpty()) {
+        args << "--memory-limit" << m_memory_limit->text();
+    }
+    run_generator(args, [this](const GeneratorResult& result){
+        QMessageBox::information(this, "Command result", result.output);
+    });
 }
 
 enum class SQLDialect {
@@ -171,26 +522,33 @@ void MainWindow::generate_sql() {
     QDialog* dialog = new QDialog{this};
     QObject::connect(dialog, &QDialog::finished, this, [this](int d) {
         SQLDialect dl = static_cast<SQLDialect>(d);
-        QProcess proc{};
+        if (!confirm_run(false, dl == SQLDialect::Oracle)) {
+            return;
+        }
         QStringList args;
-        args << "mockDbGenerator.py" << "--file" << (m_schema_name->text() + ".json");
+        args << "--file" << (m_schema_name->text() + ".json");
         args << "--sql";
+        if (m_profile->isChecked()) {
+            args << "--profile";
+        }
+        if (m_statistics->isChecked()) {
+            args << "--statistics";
+        }
+        if (!m_memory_limit->text().isEmpty()) {
+            args << "--memory-limit" << m_memory_limit->text();
+        }
         if (dl == SQLDialect::Oracle) {
             args << "--dialect" << "oracle";
         } else {
             args << "--dialect" << "postgres";
         }
-        proc.start("py", args);
-        if (!proc.waitForFinished()) {
-            qDebug() << "Process failed";
-        }
-        auto error = proc.readAllStandardError();
-        auto output = proc.readAllStandardOutput();
-        if (error.length() > 0) {
-            QMessageBox::information(this, "Command exited with text on stderr", "STDERR: " + error + "\nSTDOUT: " + output);
-        } else {
-            QMessageBox::information(this, "Command result", output);
-        }
+        run_generator(args, [this](const GeneratorResult& result){
+            if (result.error.length() > 0) {
+                QMessageBox::information(this, "Command exited with text on stderr", "STDERR: " + result.error + "\nSTDOUT: " + result.output);
+            } else {
+                QMessageBox::information(this, "Command result", result.output);
+            }
+        });
     });
     dialog->setWindowTitle("Choose dialect");
     QVBoxLayout* dialog_layout = new QVBoxLayout;
@@ -214,6 +572,57 @@ void MainWindow::generate_sql() {
 
 
 }
+void MainWindow::show_diagnostics() {
+    QFile file{m_schema_name->text() + ".profile.json"};
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::information(this, "Diagnostics", "No profile found for " + m_schema_name->text() + ", generate some data with \"Profile\" checked first");
+        return;
+    }
+    auto doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject() || !doc["stages"].isArray()) {
+        QMessageBox::information(this, "Diagnostics", file.fileName() + " is not a profile");
+        return;
+    }
+    const auto& stages = doc["stages"].toArray();
+    const std::array<QString, 8> columns{
+        "Stage", "Table", "Attribute", "Calls", "Time (ms)", "Rows", "Bytes", "Allocated bytes"
+    };
+    const std::array<QString, 8> keys{
+        "stage", "table", "attribute", "calls", "elapsed_ms", "rows", "bytes", "allocations"
+    };
+    QDialog* dialog = new QDialog{this};
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Diagnostics - " + m_schema_name->text());
+    QVBoxLayout* dialog_layout = new QVBoxLayout;
+    QTableWidget* table = new QTableWidget{static_cast<int>(stages.size()), static_cast<int>(columns.size()), dialog};
+    for (int col = 0; col < static_cast<int>(columns.size()); ++col) {
+        table->setHorizontalHeaderItem(col, new QTableWidgetItem{columns[col]});
+    }
+    int row = 0;
+    for (const auto& jstage : stages) {
+        const auto& stage = jstage.toObject();
+        for (int col = 0; col < static_cast<int>(keys.size()); ++col) {
+            const auto& value = stage[keys[col]];
+            auto* item = new QTableWidgetItem{};
+            // numbers are stored as such so that sorting by column is numeric
+            if (value.isDouble()) {
+                item->setData(Qt::DisplayRole, value.toDouble());
+            } else {
+                item->setData(Qt::DisplayRole, value.toString("-"));
+            }
+            item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+            table->setItem(row, col, item);
+        }
+        ++row;
+    }
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->setSortingEnabled(true);
+    dialog_layout->addWidget(table);
+    dialog->setLayout(dialog_layout);
+    dialog->resize(800, 400);
+    dialog->open();
+}
+
 void MainWindow::import_json() {
     QString fileName = QFileDialog::getOpenFileName(this, tr("Open File"),
                                                     QDir::currentPath(),
@@ -231,6 +640,9 @@ void MainWindow::import_json() {
     if (!tablesArray.isArray()) {
         return;
     }
+    const auto& jscaleFactor = schema["scale_factor"];
+    m_scale_factor->setText(jscaleFactor.isDouble() ? QString::number(jscaleFactor.toDouble()) : "1");
+    m_sort_by_pk->setChecked(schema["sort_by_primary_key"].toBool(false));
     const auto& tablesArrayRef = tablesArray.toArray();
     for (const auto& tbl : tablesArrayRef) {
         parse_json_table(tbl);
@@ -248,7 +660,7 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
         return;
     }
     auto tableName = jtableName.toString();
-    auto rowNumber = jquantity.isDouble() ? static_cast<int>(jquantity.toDouble()) : jquantity.toString().toInt();
+    auto rowNumber = jquantity.isDouble() ? static_cast<qint64>(jquantity.toDouble()) : jquantity.toString().toLongLong();
     auto attributes = jattributesArray.toArray();
     if (attributes.size() > 0) {
         tbl->setAttributesVisible();
@@ -264,6 +676,26 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
     });
     tbl->setName(tableName);
     tbl->setRowNumber(rowNumber);
+    tbl->setGenerate(jtbl["generate"].toBool(true));
+    const auto& jscaling = jtbl["scaling"];
+    if (jscaling.isObject() || jscaling.isString()) {
+        auto mode = (jscaling.isString() ? jscaling.toString() : jscaling["mode"].toString()).toUpper();
+        auto ratio = jscaling["ratio"];
+        auto ratioText = ratio.isDouble() ? QString::number(ratio.toDouble()) : ratio.toString();
+        if (mode == "FIXED") {
+            tbl->setScaling(MockTable::ScalingMode::Fixed, "", "");
+        } else if (mode == "PROPORTIONAL") {
+            tbl->setScaling(MockTable::ScalingMode::Proportional, jscaling["table"].toString(), ratioText);
+        } else {
+            tbl->setScaling(MockTable::ScalingMode::Linear, "", "");
+        }
+    }
+    const auto& jtime_series = jtbl["time_series"];
+    if (jtime_series.isObject()) {
+        const auto& jitter = jtime_series["jitter"];
+        tbl->setTimeSeries(jtime_series["entity"].toString(), jtime_series["timestamp"].toString(),
+                           jitter.isDouble() ? QString::number(jitter.toDouble()) : jitter.toString());
+    }
     for (const auto& jattr : attributes) {
         if (!jattr.isObject()) {
             continue;
@@ -281,6 +713,7 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
             wattr->set_pk();
         }
         wattr->setName(attrName);
+        wattr->setNullFraction(attr["null_fraction"]);
         if (attrType == "FOREIGN_KEY") {
             wattr->set_fk();
             const auto& jrefs = attr["references"];
@@ -300,7 +733,10 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
                 wattr->setStep(attr["step"]);
             } else if (attrType == "STRING") {
                 wattr->setAttrType(MockAttribute::AttributeType::String);
-                wattr->setLength(attr["length"].toString());
+                const auto& jlength = attr["length"];
+                if (jlength.isString() || jlength.isDouble()) {
+                    wattr->setLength(jlength.isDouble() ? QString::number(jlength.toInt()) : jlength.toString());
+                }
             } else if (attrType == "REAL") {
                 wattr->setAttrType(MockAttribute::AttributeType::Real);
                 wattr->setStart(attr["start"].isString() ? attr["start"].toString() : "0");
@@ -326,6 +762,15 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
                 wattr->setGenType(MockAttribute::GenerationType::Phone);
             } else if (genType == "NATURALTEXT") {
                 wattr->setGenType(MockAttribute::GenerationType::NaturalText);
+            } else if (genType == "EXPRESSION") {
+                wattr->setGenType(MockAttribute::GenerationType::Expression);
+                wattr->setExpression(attr["expression"].toString());
+            } else if (genType == "ENUM") {
+                wattr->setGenType(MockAttribute::GenerationType::Enum);
+                wattr->setEnumValues(attr["values"], attr["weights"]);
+            }
+            if (attr.contains("distribution")) {
+                wattr->setDistribution(attr["distribution"]);
             }
         }
     }
@@ -333,6 +778,10 @@ void MainWindow::parse_json_table(const QJsonValue& jtbl) {
 
 MainWindow::~MainWindow()
 {
+    stop_worker();
+    if (m_process) {
+        m_process->disconnect(this);
+    }
     delete ui;
 }
 
@@ -3,11 +3,26 @@
 
 #include <QMainWindow>
 #include <QVector>
+#include <QTimer>
+#include <QTableWidget>
+#include <QLabel>
+#include <QCheckBox>
+#include <QProcess>
 #include "mocktable.h"
+#include "estimator.h"
+#include <functional>
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+struct GeneratorResult {
+    int exit_code{};
+    QString output;
+    QString error;
+};
+
+using GeneratorCallback = std::function<void(const GeneratorResult&)>;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -16,15 +31,45 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     MockTable* add_table();
+    QJsonObject schema_json() const;
     void dump_to_json();
     void generate_sql();
     void generate_csv();
     void import_json();
+    void show_diagnostics();
+    void schedule_estimate();
+    void update_estimate();
+    void calibrate();
+    bool confirm_run(bool csv, bool oracle);
+    void run_generator(const QStringList& args, GeneratorCallback done);
     void parse_json_table(const QJsonValue& obj);
 private:
     Ui::MainWindow *ui;
     QVector<MockTable*> tables;
     QLineEdit* m_schema_name{};
+    QLineEdit* m_scale_factor{};
+    QLineEdit* m_memory_limit{};
+    QCheckBox* m_sort_by_pk{};
+    QCheckBox* m_profile{};
+    QCheckBox* m_statistics{};
+    Estimator m_estimator{};
+    QTimer* m_estimate_timer{};
+    QTableWidget* m_estimate_table{};
+    QLabel* m_estimate_total{};
+    QProcess* m_worker{};
+    QByteArray m_worker_buffer{};
+    int m_request_id{};
+    QProcess* m_process{};
+    QStringList m_request_args{};
+    GeneratorCallback m_request_done{};
+    int m_request_attempts{};
+    bool start_worker();
+    void stop_worker();
+    void send_request();
+    void read_worker_output();
+    void worker_finished();
+    void run_process();
+    void finish_request(const GeneratorResult& result);
 
 };
 #endif // MAINWINDOW_H
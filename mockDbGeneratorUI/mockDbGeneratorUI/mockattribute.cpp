@@ -1,6 +1,8 @@
 #include "mockattribute.h"
 #include "qcombobox.h"
 #include <QLabel>
+#include <QDoubleValidator>
+#include <QJsonArray>
 using GT = MockAttribute::GenerationType;
 using AT = MockAttribute::AttributeType;
 
@@ -15,12 +17,39 @@ auto up(std::underlying_type_t<Enum> e) {
     return static_cast<Enum>(e);
 }
 
+template <typename Enum>
+requires std::is_enum_v<Enum>
+struct EnumIterator {
+    using Ret = std::underlying_type_t<Enum>;
+    Ret m_value;
+    EnumIterator(Enum v) : m_value{down(v)} {}
+    EnumIterator& operator++() { ++m_value; return *this; }
+    Enum operator*() const { return static_cast<Enum>(m_value); }
+    bool operator!=(const EnumIterator& other) const { return m_value != other.m_value; }
+};
+
+template <typename Enum>
+requires std::is_enum_v<Enum>
+struct EnumForEach {
+    auto begin() const { return EnumIterator<Enum>{Enum{}}; }
+    auto end() const { return EnumIterator<Enum>{static_cast<Enum>(QMetaEnum::fromType<Enum>().keyCount())}; }
+};
+
+template <typename Enum>
+requires std::is_enum_v<Enum>
+auto for_each_enum() {
+    return EnumForEach<Enum>{};
+}
+
 
 static bool check_for_string_only(GT gen) {
     return gen == GT::NameSurname || gen == GT::Email || gen == GT::Phone || gen == GT::NaturalText;
 }
 
 static bool type_gen_compatible(GT gen, AT type) {
+    if (gen == GT::Expression || gen == GT::Enum) {
+        return true;
+    }
     switch (type) {
     case AT::Integer:
     case AT::Real:
@@ -33,30 +62,15 @@ static bool type_gen_compatible(GT gen, AT type) {
     return false;
 }
 
+// gbox only lists the generations compatible with the current type, in enum order
 static GT convert_gbox_idx_to_type(int index, AT type) {
-    if (type != AT::String) {
-        // for integers and real conversion is direct
-        // since they're all valid
-        return up<GT>(index);
-    } else {
-        // string type is only valid with random and repeating
-        switch (index) {
-        case 0:
-            return GT::Random;
-        case 1:
-            return GT::Repeating;
-        case 2:
-            return GT::NameSurname;
-        case 3:
-            return GT::Email;
-        case 4:
-            return GT::Phone;
-        case 5:
-            return GT::NaturalText;
-        default:
-            return GT::Random;
+    int i = 0;
+    for (auto v : for_each_enum<GT>()) {
+        if (type_gen_compatible(v, type) && i++ == index) {
+            return v;
         }
     }
+    return GT::Random;
 }
 
 
@@ -79,26 +93,36 @@ static AT convert_tbox_idx_to_type(int index, GT type) {
 }
 
 static int correct_gbox_index(GT gen, AT type) {
-    if (type == AT::String) {
-        switch (gen) {
-            case GT::Random:
-                return 0;
-            case GT::Repeating:
-                return 1;
-            case GT::NameSurname:
-                return 2;
-            case GT::Email:
-                return 3;
-            case GT::Phone:
-                return 4;
-            case GT::NaturalText:
-                return 5;
-            default:
-                return 0;
+    int i = 0;
+    for (auto v : for_each_enum<GT>()) {
+        if (v == gen) {
+            return type_gen_compatible(v, type) ? i : 0;
+        }
+        if (type_gen_compatible(v, type)) {
+            ++i;
         }
-    } else {
-        return down(gen);
     }
+    return 0;
+}
+
+// parameters of every distribution, shown as placeholder of the parameters field
+static QString distribution_placeholder(MockAttribute::Distribution distribution) {
+    using D = MockAttribute::Distribution;
+    switch (distribution) {
+    case D::Uniform:
+        return "low=0, high=step, min=, max=";
+    case D::Normal:
+        return "mean=0, stddev=1, min=, max=";
+    case D::LogNormal:
+        return "mu=0, sigma=1, min=, max=";
+    case D::Exponential:
+        return "mean=1 (or rate=1), min=, max=";
+    case D::Zipf:
+        return "s=1, n=step, min=, max=";
+    case D::Default:
+        break;
+    }
+    return "";
 }
 
 static int correct_tbox_index(GT gen, AT type) {
@@ -112,31 +136,6 @@ static int correct_tbox_index(GT gen, AT type) {
 }
 
 
-template <typename Enum>
-requires std::is_enum_v<Enum>
-struct EnumIterator {
-    using Ret = std::underlying_type_t<Enum>;
-    Ret m_value;
-    EnumIterator(Enum v) : m_value{down(v)} {}
-    EnumIterator& operator++() { ++m_value; return *this; }
-    Enum operator*() const { return static_cast<Enum>(m_value); }
-    bool operator!=(const EnumIterator& other) const { return m_value != other.m_value; }
-};
-
-template <typename Enum>
-requires std::is_enum_v<Enum>
-struct EnumForEach {
-    auto begin() const { return EnumIterator<Enum>{Enum{}}; }
-    auto end() const { return EnumIterator<Enum>{static_cast<Enum>(QMetaEnum::fromType<Enum>().keyCount())}; }
-};
-
-template <typename Enum>
-requires std::is_enum_v<Enum>
-auto for_each_enum() {
-    return EnumForEach<Enum>{};
-}
-
-
 MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidget *tbl)
     : QWidget{tbl}, m_name{attr_name}
 {
@@ -148,6 +147,7 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
     name_edit->setText(m_name);
     QObject::connect(name_edit, &QLineEdit::editingFinished, this, [this] (){
         m_name = name_edit->text();
+        emit changed();
     });
     tbox = new QComboBox{this};
     kbox = new QComboBox{this};
@@ -162,7 +162,9 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
     }
     // generation
     for (auto v : for_each_enum<GT>()) {
-        gbox->addItem(enum_to_string(v));
+        if (type_gen_compatible(v, m_attr_type)) {
+            gbox->addItem(enum_to_string(v));
+        }
     }
     QObject::connect(tbox, &QComboBox::currentIndexChanged, this, [this](int index){
         AT val = convert_tbox_idx_to_type(index, m_gen_type);
@@ -179,14 +181,10 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
             start->setEnabled(true);
             step->setEnabled(true);
         }
-        const bool isDate = m_attr_type == AT::Date;
-        start_date->setHidden(!isDate);
-        start->setHidden(isDate);
-        step_date->setHidden(!isDate);
-        step->setHidden(isDate);
         if (!type_gen_compatible(m_gen_type, m_attr_type)) {
             m_gen_type = GT::Random;
         }
+        update_value_widgets();
         gbox->blockSignals(true);
         gbox->clear();
         for (auto v : for_each_enum<GT>()) {
@@ -196,6 +194,8 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
         }
         gbox->setCurrentIndex(correct_gbox_index(m_gen_type, m_attr_type));
         gbox->blockSignals(false);
+        update_distribution_widgets();
+        emit changed();
     });
     QObject::connect(gbox, &QComboBox::currentIndexChanged, this, [this](int index){
         GT val = convert_gbox_idx_to_type(index, m_attr_type);
@@ -208,6 +208,7 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
         } else {
             length->setEnabled(true);
         }
+        update_value_widgets();
         tbox->blockSignals(true);
         tbox->clear();
         for (auto v : for_each_enum<AT>()) {
@@ -217,7 +218,8 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
         }
         tbox->setCurrentIndex(correct_tbox_index(m_gen_type, m_attr_type));
         tbox->blockSignals(false);
-
+        update_distribution_widgets();
+        emit changed();
     });
     QObject::connect(kbox, &QComboBox::currentIndexChanged, this, [this](int index) {
         KeyType v = up<KeyType>(index);
@@ -260,6 +262,8 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
         }
         tbox->blockSignals(false);
         gbox->blockSignals(false);
+        update_distribution_widgets();
+        emit changed();
     });
     // start
     QWidget* start_container = new QWidget{this};
@@ -270,8 +274,17 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
     start->setValidator(new QIntValidator{start});
     start_date = new QDateEdit{start_container};
     start_date->setHidden(true);
+    expression = new QLineEdit{start_container};
+    expression->setPlaceholderText("e.g. qty * price");
+    expression->setHidden(true);
+    enum_values = new QLineEdit{start_container};
+    enum_values->setPlaceholderText("e.g. new, paid=3, shipped");
+    enum_values->setToolTip("Comma separated values, each optionally followed by =weight");
+    enum_values->setHidden(true);
     start_cont_layout->addWidget(start);
     start_cont_layout->addWidget(start_date);
+    start_cont_layout->addWidget(expression);
+    start_cont_layout->addWidget(enum_values);
 
     // step
     QWidget* step_container = new QWidget{this};
@@ -291,6 +304,7 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
         QLineEdit* edit = new QLineEdit{step_date};
         edit->setText(prop == "days" ? "1" : "0");
         edit->setValidator(new QIntValidator{edit});
+        QObject::connect(edit, &QLineEdit::textChanged, this, [this](const QString&){ emit changed(); });
         dateStepLayout->addWidget(label, row_inner, 0);
         dateStepLayout->addWidget(edit, row_inner, 1);
         ++row_inner;
@@ -310,6 +324,30 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
     ref_attr = new QLineEdit{this};
     ref_table->setDisabled(true);
     ref_attr->setDisabled(true);
+    // distribution and its parameters as "name=value, ..."
+    QWidget* distribution_container = new QWidget{this};
+    QHBoxLayout* distribution_layout = new QHBoxLayout;
+    distribution_container->setLayout(distribution_layout);
+    dbox = new QComboBox{distribution_container};
+    for (auto v : for_each_enum<Distribution>()) {
+        dbox->addItem(enum_to_string(v));
+    }
+    distribution_params = new QLineEdit{distribution_container};
+    distribution_layout->addWidget(dbox);
+    distribution_layout->addWidget(distribution_params);
+    QObject::connect(dbox, &QComboBox::currentIndexChanged, this, [this](int) {
+        update_distribution_widgets();
+        emit changed();
+    });
+    null_fraction = new QLineEdit{this};
+    null_fraction->setPlaceholderText("0");
+    null_fraction->setValidator(new QDoubleValidator{0.0, 1.0, 6, null_fraction});
+    null_fraction->setToolTip("Fraction of the rows which are NULL");
+    update_distribution_widgets();
+    for (QLineEdit* edit : {start, step, length, ref_table, ref_attr, expression, enum_values, distribution_params, null_fraction}) {
+        QObject::connect(edit, &QLineEdit::textChanged, this, [this](const QString&){ emit changed(); });
+    }
+    QObject::connect(start_date, &QDateEdit::dateChanged, this, [this](QDate){ emit changed(); });
 
     hl->addWidget(name_edit, row, 0);
     hl->addWidget(tbox, row, 1);
@@ -320,13 +358,18 @@ MockAttribute::MockAttribute(QString attr_name, int row, QGridLayout* hl, QWidge
     hl->addWidget(length, row, 6);
     hl->addWidget(ref_table, row, 7);
     hl->addWidget(ref_attr, row, 8);
-    hl->addWidget(delete_button, row, 9);
+    hl->addWidget(distribution_container, row, 9);
+    hl->addWidget(null_fraction, row, 10);
+    hl->addWidget(delete_button, row, 11);
 }
 
 QJsonObject MockAttribute::to_json() const {
     std::array<QString, 7> dateStepProps{ "microseconds", "milliseconds", "seconds", "minutes", "hours", "days", "weeks"};
     QJsonObject obj{};
     obj.insert("name", m_name);
+    if (null_fraction->isEnabled() && null_fraction->text().toDouble() > 0) {
+        obj.insert("null_fraction", null_fraction->text().toDouble());
+    }
     if (m_key_type == KeyType::ForeignKey) {
         obj.insert("type", "foreign_key");
         QJsonObject references{};
@@ -337,6 +380,49 @@ QJsonObject MockAttribute::to_json() const {
     }
     obj.insert("type", enum_to_string(m_attr_type));
     obj.insert("generation", enum_to_string(m_gen_type));
+    if (m_gen_type == GT::Expression) {
+        obj.insert("expression", expression->text());
+        // without a length the longest string the expression can build is used
+        if (m_attr_type == AT::String && !length->text().isEmpty()) {
+            obj.insert("length", length->text());
+        }
+        return obj;
+    }
+    if (m_gen_type == GT::Enum) {
+        // "value=weight", values without a weight weigh 1
+        QJsonArray values{};
+        QJsonArray weights{};
+        bool weighted = false;
+        for (const auto& item : enum_values->text().split(',', Qt::SkipEmptyParts)) {
+            QString value = item.trimmed();
+            double weight = 1.0;
+            const auto at = value.lastIndexOf('=');
+            bool ok = false;
+            const double parsed = at >= 0 ? value.mid(at + 1).trimmed().toDouble(&ok) : 0.0;
+            if (ok) {
+                weight = parsed;
+                weighted = true;
+                value = value.left(at).trimmed();
+            }
+            if (m_attr_type == AT::Integer) {
+                values.append(value.toLongLong());
+            } else if (m_attr_type == AT::Real) {
+                values.append(value.toDouble());
+            } else {
+                values.append(value);
+            }
+            weights.append(weight);
+        }
+        obj.insert("values", values);
+        if (weighted) {
+            obj.insert("weights", weights);
+        }
+        // without a length the longest value is used
+        if (m_attr_type == AT::String && !length->text().isEmpty()) {
+            obj.insert("length", length->text());
+        }
+        return obj;
+    }
     if (m_attr_type == AT::Date) {
         auto date = start_date->date();
         QString date_format = QString::asprintf("%04d-%02d-%02d", date.year(), date.month(), date.day());
@@ -358,6 +444,20 @@ QJsonObject MockAttribute::to_json() const {
     if (m_attr_type == AT::String && (!check_for_string_only(m_gen_type) || m_gen_type == GT::NaturalText)) {
         obj.insert("length", length->text());
     }
+    const auto distribution = up<Distribution>(dbox->currentIndex());
+    if (dbox->isEnabled() && distribution != Distribution::Default) {
+        QJsonObject distribution_obj{};
+        distribution_obj.insert("type", enum_to_string(distribution).toLower());
+        for (const auto& param : distribution_params->text().split(',', Qt::SkipEmptyParts)) {
+            const auto pair = param.split('=');
+            bool ok = false;
+            const double value = pair.size() == 2 ? pair[1].trimmed().toDouble(&ok) : 0.0;
+            if (ok) {
+                distribution_obj.insert(pair[0].trimmed().toLower(), value);
+            }
+        }
+        obj.insert("distribution", distribution_obj);
+    }
     return obj;
 }
 
@@ -392,5 +492,69 @@ void MockAttribute::setStep(const QJsonValue& step) {
     }
 }
 void MockAttribute::setLength(const QString& length) {
-
+    this->length->setText(length);
+}
+void MockAttribute::setExpression(const QString& text) {
+    expression->setText(text);
+}
+void MockAttribute::setEnumValues(const QJsonValue& values, const QJsonValue& weights) {
+    const auto valueArray = values.toArray();
+    const auto weightArray = weights.toArray();
+    QStringList items{};
+    for (qsizetype i = 0; i < valueArray.size(); ++i) {
+        QString item = valueArray[i].isDouble() ? QString::number(valueArray[i].toDouble()) : valueArray[i].toString();
+        if (i < weightArray.size() && weightArray[i].toDouble() != 1.0) {
+            item += "=" + QString::number(weightArray[i].toDouble());
+        }
+        items << item;
+    }
+    enum_values->setText(items.join(", "));
+}
+void MockAttribute::setDistribution(const QJsonValue& distribution) {
+    const auto type = (distribution.isString() ? distribution.toString() : distribution["type"].toString()).toLower();
+    QStringList params{};
+    if (distribution.isObject()) {
+        const auto& obj = distribution.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            if (it.key() != "type") {
+                params << it.key() + "=" + (it->isDouble() ? QString::number(it->toDouble()) : it->toString());
+            }
+        }
+    }
+    for (auto v : for_each_enum<Distribution>()) {
+        if (enum_to_string(v).toLower() == type) {
+            dbox->setCurrentIndex(down(v));
+        }
+    }
+    distribution_params->setText(params.join(", "));
+}
+void MockAttribute::setNullFraction(const QJsonValue& fraction) {
+    if (fraction.isDouble()) {
+        null_fraction->setText(QString::number(fraction.toDouble()));
+    } else if (fraction.isString()) {
+        null_fraction->setText(fraction.toString());
+    }
+}
+void MockAttribute::update_distribution_widgets() {
+    // distributions only replace the uniform draw of random numbers, primary keys are never NULL
+    const bool numeric = m_attr_type == AT::Integer || m_attr_type == AT::Real;
+    const bool enabled = m_key_type != KeyType::ForeignKey && numeric && m_gen_type == GT::Random;
+    const auto distribution = up<Distribution>(dbox->currentIndex());
+    dbox->setEnabled(enabled);
+    distribution_params->setEnabled(enabled && distribution != Distribution::Default);
+    distribution_params->setPlaceholderText(distribution_placeholder(distribution));
+    null_fraction->setEnabled(m_key_type != KeyType::PrimaryKey);
+}
+void MockAttribute::update_value_widgets() {
+    // start holds the expression or the values when the attribute is computed or an enum, steps don't apply to them
+    const bool isExpression = m_gen_type == GT::Expression;
+    const bool isEnum = m_gen_type == GT::Enum;
+    const bool isDate = m_attr_type == AT::Date;
+    expression->setHidden(!isExpression);
+    enum_values->setHidden(!isEnum);
+    start_date->setHidden(!isDate || isExpression || isEnum);
+    start->setHidden(isDate || isExpression || isEnum);
+    step_date->setHidden(!isDate || isExpression || isEnum);
+    step->setHidden(isDate || isExpression || isEnum);
+    length->setPlaceholderText(isExpression || isEnum ? "auto" : "");
 }
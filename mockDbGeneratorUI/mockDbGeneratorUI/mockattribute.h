@@ -35,17 +35,29 @@ public:
         NameSurname,
         Email,
         Phone,
-        NaturalText
+        NaturalText,
+        Expression,
+        Enum
     };
     enum class KeyType {
         None,
         PrimaryKey,
         ForeignKey
     };
+    // of random integers and reals, Default keeps the uniform draw from 0 to step
+    enum class Distribution {
+        Default,
+        Uniform,
+        Normal,
+        LogNormal,
+        Exponential,
+        Zipf
+    };
 
     Q_ENUM(AttributeType);
     Q_ENUM(GenerationType);
     Q_ENUM(KeyType);
+    Q_ENUM(Distribution);
 private:
     QString m_name;
     KeyType m_key_type{KeyType::None};
@@ -62,8 +74,16 @@ private:
     QLineEdit* length{};
     QLineEdit* ref_table{};
     QLineEdit* ref_attr{};
+    QLineEdit* expression{};
+    QLineEdit* enum_values{};
+    QComboBox* dbox{};
+    QLineEdit* distribution_params{};
+    QLineEdit* null_fraction{};
     QPushButton* delete_button{};
 
+    void update_value_widgets();
+    void update_distribution_widgets();
+
 public:
 
     explicit MockAttribute(QString name, int row, QGridLayout* layout, QWidget *parent = nullptr);
@@ -76,13 +96,18 @@ public:
     void setStart(const QString& start);
     void setStep(const QJsonValue& step);
     void setLength(const QString& length);
+    void setExpression(const QString& text);
+    void setEnumValues(const QJsonValue& values, const QJsonValue& weights);
+    void setDistribution(const QJsonValue& distribution);
+    void setNullFraction(const QJsonValue& fraction);
     void setName(const QString& name) { m_name = name; name_edit->setText(m_name); }
     void setRefTable(const QString& tblName) { ref_table->setText(tblName); }
     void setRefAttr(const QString& tblAttr) { ref_attr->setText(tblAttr); }
     const QString& name() const { return m_name; }
     QPushButton* delete_btn() { return delete_button; }
 signals:
-
+    // emitted whenever a property which ends up in to_json() is edited
+    void changed();
 };
 
 #endif // MOCKATTRIBUTE_H
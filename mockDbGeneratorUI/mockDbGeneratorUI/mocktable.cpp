@@ -7,6 +7,8 @@
 #include <QJsonArray>
 #include <QLabel>
 #include <QMessageBox>
+#include <QRegularExpressionValidator>
+#include <QDoubleValidator>
 
 class GridLayoutUtil {
 
@@ -63,7 +65,7 @@ MockTable::MockTable(QWidget *parent)
     QGridLayout* tblAttrGridWidget = new QGridLayout;
     tblAttrWidget->setLayout(tblAttrWidgetLayout);
     tblAttrNamesWidget->setLayout(tblAttrGridWidget);
-    const std::array<QString, 9> labelTexts{
+    const std::array<QString, 11> labelTexts{
         "Name",
         "Type",
         "Key type",
@@ -72,7 +74,9 @@ MockTable::MockTable(QWidget *parent)
         "Step",
         "Length",
         "Ref. table",
-        "Ref. attr."
+        "Ref. attr.",
+        "Distribution",
+        "Null fraction"
     };
     int i = 0;
     for (const auto& text : labelTexts) {
@@ -85,13 +89,48 @@ MockTable::MockTable(QWidget *parent)
     nameWidget = new QLineEdit{"table_name", tblAttrWidget};
     QLabel* label2 = new QLabel{"Row count:", tblAttrWidget};
     rowsWidget = new QLineEdit{"100", tblAttrWidget};
+    QLabel* label3 = new QLabel{"Scaling:", tblAttrWidget};
+    scalingWidget = new QComboBox{tblAttrWidget};
+    scalingTableWidget = new QLineEdit{tblAttrWidget};
+    scalingRatioWidget = new QLineEdit{tblAttrWidget};
+    generateWidget = new QCheckBox{"Generate", tblAttrWidget};
+    generateWidget->setChecked(true);
+    generateWidget->setToolTip("Unchecked tables are not written, tables referencing them still sample their keys");
+    QLabel* label4 = new QLabel{"Time series:", tblAttrWidget};
+    timeSeriesEntityWidget = new QLineEdit{tblAttrWidget};
+    timeSeriesTimestampWidget = new QLineEdit{tblAttrWidget};
+    timeSeriesJitterWidget = new QLineEdit{tblAttrWidget};
+    timeSeriesEntityWidget->setPlaceholderText("Entity foreign key");
+    timeSeriesEntityWidget->setToolTip("Rows are events of the entities of the referenced table, merged in time order");
+    timeSeriesTimestampWidget->setPlaceholderText("Timestamp");
+    timeSeriesTimestampWidget->setToolTip("Date attribute whose start and step are the first interval and the interval of every entity");
+    timeSeriesJitterWidget->setPlaceholderText("Jitter 0.5");
+    timeSeriesJitterWidget->setValidator(new QDoubleValidator{0.0, 1.0, 6, timeSeriesJitterWidget});
     QPushButton* addAttributeButton = new QPushButton{"Add attribute", tblAttrWidget};
     deleteBtn = new QPushButton{"Delete table", parent};
-    rowsWidget->setValidator(new QIntValidator{0, 10'000'000, rowsWidget});
+    // row counts are 64 bit, QIntValidator only goes up to INT_MAX
+    rowsWidget->setValidator(new QRegularExpressionValidator{QRegularExpression{"\\d{1,18}"}, rowsWidget});
+    for (auto mode : {ScalingMode::Linear, ScalingMode::Fixed, ScalingMode::Proportional}) {
+        scalingWidget->addItem(enum_to_string(mode));
+    }
+    scalingTableWidget->setPlaceholderText("Scale with table");
+    scalingRatioWidget->setPlaceholderText("Ratio");
+    scalingRatioWidget->setValidator(new QDoubleValidator{0.0, 1e12, 6, scalingRatioWidget});
+    scalingTableWidget->setEnabled(false);
+    scalingRatioWidget->setEnabled(false);
     tblAttrWidgetLayout->addWidget(label1);
     tblAttrWidgetLayout->addWidget(nameWidget);
     tblAttrWidgetLayout->addWidget(label2);
     tblAttrWidgetLayout->addWidget(rowsWidget);
+    tblAttrWidgetLayout->addWidget(label3);
+    tblAttrWidgetLayout->addWidget(scalingWidget);
+    tblAttrWidgetLayout->addWidget(scalingTableWidget);
+    tblAttrWidgetLayout->addWidget(scalingRatioWidget);
+    tblAttrWidgetLayout->addWidget(generateWidget);
+    tblAttrWidgetLayout->addWidget(label4);
+    tblAttrWidgetLayout->addWidget(timeSeriesEntityWidget);
+    tblAttrWidgetLayout->addWidget(timeSeriesTimestampWidget);
+    tblAttrWidgetLayout->addWidget(timeSeriesJitterWidget);
     tblAttrWidgetLayout->addWidget(addAttributeButton);
     tblAttrWidgetLayout->addWidget(deleteBtn);
     QObject::connect(addAttributeButton, &QPushButton::clicked, this, [this](bool c){
@@ -102,10 +141,32 @@ MockTable::MockTable(QWidget *parent)
     });
     QObject::connect(nameWidget, &QLineEdit::editingFinished, this, [this](){
         name = nameWidget->text();
+        emit changed();
+    });
+    QObject::connect(rowsWidget, &QLineEdit::textChanged, this, [this](const QString& text) {
+        rows = text.toLongLong();
+        emit changed();
+    });
+    QObject::connect(scalingWidget, &QComboBox::currentIndexChanged, this, [this](int index) {
+        const bool proportional = static_cast<ScalingMode>(index) == ScalingMode::Proportional;
+        scalingTableWidget->setEnabled(proportional);
+        scalingRatioWidget->setEnabled(proportional);
+        emit changed();
     });
-    QObject::connect(rowsWidget, &QLineEdit::editingFinished, this, [this]() {
-        rows = rowsWidget->text().toInt();
+    QObject::connect(generateWidget, &QCheckBox::toggled, this, [this](bool) {
+        emit changed();
     });
+    QObject::connect(scalingTableWidget, &QLineEdit::textChanged, this, [this](const QString&) {
+        emit changed();
+    });
+    QObject::connect(scalingRatioWidget, &QLineEdit::textChanged, this, [this](const QString&) {
+        emit changed();
+    });
+    for (QLineEdit* edit : {timeSeriesEntityWidget, timeSeriesTimestampWidget, timeSeriesJitterWidget}) {
+        QObject::connect(edit, &QLineEdit::textChanged, this, [this](const QString&) {
+            emit changed();
+        });
+    }
     layout()->addWidget(tblAttrWidget);
     layout()->addWidget(tblAttrNamesWidget);
 }
@@ -118,6 +179,7 @@ MockAttribute* MockTable::add_attribute() {
     layout()->addWidget(wd);
     attributes.append(wd);
     qDebug() << "row numbers: " << attribute_row_numbers;
+    QObject::connect(wd, &MockAttribute::changed, this, &MockTable::changed);
     QObject::connect(wd->delete_btn(), &QPushButton::clicked, this, [this, wd](bool){
         int attrIdx = attributes.indexOf(wd);
         qDebug() << "removing attribute at index " << attrIdx;
@@ -137,13 +199,45 @@ MockAttribute* MockTable::add_attribute() {
         if (attributes.empty()) {
             tblAttrNamesWidget->setVisible(false);
         }
+        emit changed();
     });
+    emit changed();
     return wd;
 }
+void MockTable::setScaling(ScalingMode mode, const QString& table, const QString& ratio) {
+    scalingWidget->setCurrentIndex(static_cast<int>(mode));
+    scalingTableWidget->setText(table);
+    scalingRatioWidget->setText(ratio);
+}
+void MockTable::setTimeSeries(const QString& entity, const QString& timestamp, const QString& jitter) {
+    timeSeriesEntityWidget->setText(entity);
+    timeSeriesTimestampWidget->setText(timestamp);
+    timeSeriesJitterWidget->setText(jitter);
+}
 QJsonObject MockTable::to_json() const {
     QJsonObject obj{};
     obj.insert("name", name);
     obj.insert("rows", rows);
+    QJsonObject scaling{};
+    auto mode = static_cast<ScalingMode>(scalingWidget->currentIndex());
+    scaling.insert("mode", enum_to_string(mode).toLower());
+    if (mode == ScalingMode::Proportional) {
+        scaling.insert("table", scalingTableWidget->text());
+        if (!scalingRatioWidget->text().isEmpty()) {
+            scaling.insert("ratio", scalingRatioWidget->text().toDouble());
+        }
+    }
+    obj.insert("scaling", scaling);
+    obj.insert("generate", generateWidget->isChecked());
+    if (!timeSeriesEntityWidget->text().isEmpty()) {
+        QJsonObject time_series{};
+        time_series.insert("entity", timeSeriesEntityWidget->text());
+        time_series.insert("timestamp", timeSeriesTimestampWidget->text());
+        if (!timeSeriesJitterWidget->text().isEmpty()) {
+            time_series.insert("jitter", timeSeriesJitterWidget->text().toDouble());
+        }
+        obj.insert("time_series", time_series);
+    }
     QJsonArray jprimary_keys{};
     QJsonArray jattributes{};
     for (const auto* attr : attributes) {
@@ -4,26 +4,47 @@
 #include <QWidget>
 #include <QMap>
 #include <QJsonObject>
+#include <QCheckBox>
 class MockTable : public QWidget
 {
     Q_OBJECT
+public:
+    enum class ScalingMode {
+        Linear,
+        Fixed,
+        Proportional
+    };
+    Q_ENUM(ScalingMode);
+private:
     QString name{"table_name"};
-    int rows = 100;
+    qint64 rows = 100;
     QVector<MockAttribute*> attributes{};
     QVector<int> attribute_row_numbers{};
     QPushButton* deleteBtn{};
     QWidget* tblAttrNamesWidget{};
     QLineEdit* nameWidget{nullptr};
     QLineEdit* rowsWidget{nullptr};
+    QComboBox* scalingWidget{nullptr};
+    QLineEdit* scalingTableWidget{nullptr};
+    QLineEdit* scalingRatioWidget{nullptr};
+    QCheckBox* generateWidget{nullptr};
+    QLineEdit* timeSeriesEntityWidget{nullptr};
+    QLineEdit* timeSeriesTimestampWidget{nullptr};
+    QLineEdit* timeSeriesJitterWidget{nullptr};
 public:
     explicit MockTable(QWidget *parent = nullptr);
     MockAttribute* add_attribute();
     QJsonObject to_json() const;
     QPushButton* delete_btn() { return deleteBtn; }
     void setName(const QString& str) { name = str; nameWidget->setText(name); }
-    void setRowNumber(int rowNumber) { rows = rowNumber; rowsWidget->setText(QString::number(rowNumber)); }
+    void setRowNumber(qint64 rowNumber) { rows = rowNumber; rowsWidget->setText(QString::number(rowNumber)); }
+    void setScaling(ScalingMode mode, const QString& table, const QString& ratio);
     void setAttributesVisible() { tblAttrNamesWidget->setVisible(true); }
+    void setGenerate(bool generate) { generateWidget->setChecked(generate); }
+    void setTimeSeries(const QString& entity, const QString& timestamp, const QString& jitter);
 signals:
+    // emitted when the table or one of its attributes is edited
+    void changed();
 };
 
 #endif // MOCKTABLE_H
@@ -0,0 +1,151 @@
+from __future__ import annotations
+from structureReader.reader import DbTable, SQLDialect
+from dataGenerators.generators import (
+    VALID_PATTERNS_PER_TYPE,
+    GenerationMode,
+    MALE_NAMES,
+    FEMALE_NAMES,
+    SURNAMES,
+    NATURAL_ENGLISH_WORDS,
+    KNOWN_EMAIL_DOMAINS,
+)
+from time import perf_counter
+import json
+import os
+import tempfile
+
+CALIBRATION_VERSION = 1
+CALIBRATION_ROWS = 20000
+# representative expressions, measured for the EXPRESSION generation of each type
+_EXPRESSIONS = {
+    "INTEGER": "row() * 3 + 1",
+    "REAL": "row() * 0.5 + 1",
+    "STRING": "concat('key-', row())",
+    "DATE": "date('2000-01-01') + seconds(row())",
+}
+
+# a few values with uneven weights, like the statuses and categories enums usually hold
+_ENUM_VALUES = {
+    "INTEGER": [1, 2, 3, 5, 8],
+    "REAL": [0.5, 1.0, 2.5, 10.0],
+    "STRING": ["pending", "active", "suspended", "closed"],
+    "DATE": ["2000-01-01", "2010-06-15", "2020-12-31"],
+}
+
+
+class _CountingSink:
+    def __init__(self):
+        self.bytes = 0
+
+    def write_rows(self, rows: list[str]) -> int:
+        written = len("".join(rows).encode("utf-8"))
+        self.bytes += written
+        return written
+
+
+def _average_length(values: list[str]) -> float:
+    return sum(map(len, values)) / len(values) if values else 0.0
+
+
+def _measure_generator(db_type: str, generation: GenerationMode, rows: int) -> float:
+    attribute = {"name": "value", "type": db_type, "generation": generation.name}
+    if db_type == "DATE":
+        attribute["start"] = "2000-01-01"
+    if generation == GenerationMode.EXPRESSION:
+        attribute["expression"] = _EXPRESSIONS[db_type]
+    if generation == GenerationMode.ENUM:
+        attribute["values"] = _ENUM_VALUES[db_type]
+        attribute["weights"] = list(range(len(_ENUM_VALUES[db_type]), 0, -1))
+    table = DbTable({
+        "name": "calibration",
+        "rows": rows,
+        "attributes": [attribute],
+    })
+    table.compile_expressions()
+    table.assign_seed(0)
+    attribute = table._attributes["value"]
+    start = perf_counter()
+    table.generate_column(attribute, 0, rows)
+    return rows / max(perf_counter() - start, 1e-9)
+
+
+def _measure_formatting(rows: int) -> tuple[float, float]:
+    table = DbTable({
+        "name": "calibration",
+        "rows": rows,
+        "attributes": [
+            {"name": "i", "type": "integer", "generation": "increasing"},
+            {"name": "r", "type": "real", "generation": "random", "step": "1000"},
+            {"name": "s", "type": "string", "generation": "random", "length": "12"},
+            {"name": "d", "type": "date", "generation": "increasing", "start": "2000-01-01"},
+        ],
+    })
+    table.assign_seed(0)
+    columns = table.generate_rows(0, rows)
+    sink = _CountingSink()
+    start = perf_counter()
+    table.write_csv_rows(sink, columns, rows, header=True)  # type: ignore
+    csv_rate = sink.bytes / max(perf_counter() - start, 1e-9)
+    sink = _CountingSink()
+    start = perf_counter()
+    table.write_insertion_sql(sink, columns, rows, SQLDialect.POSTGRES)  # type: ignore
+    sql_rate = sink.bytes / max(perf_counter() - start, 1e-9)
+    return csv_rate, sql_rate
+
+
+def _measure_disk(directory: str, size: int = 32 << 20) -> float:
+    block = b"x" * (1 << 20)
+    with tempfile.NamedTemporaryFile(dir=directory, delete=False) as f:
+        path = f.name
+        start = perf_counter()
+        for _ in range(size // len(block)):
+            f.write(block)
+        f.flush()
+        os.fsync(f.fileno())
+        elapsed = perf_counter() - start
+    os.remove(path)
+    return size / max(elapsed, 1e-9)
+
+
+def _measure_foreign_key(rows: int) -> float:
+    table = DbTable({
+        "name": "calibration",
+        "rows": rows,
+        "attributes": [{"name": "value", "type": "integer", "generation": "increasing"}],
+    })
+    table.assign_seed(0)
+    attribute = table._attributes["value"]
+    keys = list(range(rows))
+    start = perf_counter()
+    attribute.sample_range(0, rows, keys)
+    return rows / max(perf_counter() - start, 1e-9)
+
+
+def calibrate(filename: str = "calibration.json", rows: int = CALIBRATION_ROWS) -> dict:
+    # throughputs measured on this machine, used by the UI to predict sizes and run times
+    generators = {}
+    for db_type, modes in VALID_PATTERNS_PER_TYPE.items():
+        for mode in GenerationMode:
+            if modes & mode:
+                generators[f"{db_type.name}.{mode.name}"] = _measure_generator(db_type.name, mode, rows)
+    # foreign keys only pick from an already generated column
+    generators["FOREIGN_KEY"] = _measure_foreign_key(rows)
+    csv_rate, sql_rate = _measure_formatting(rows)
+    names = MALE_NAMES + FEMALE_NAMES
+    calibration = {
+        "version": CALIBRATION_VERSION,
+        "generator_rows_per_second": generators,
+        "csv_bytes_per_second": csv_rate,
+        "sql_bytes_per_second": sql_rate,
+        "disk_bytes_per_second": _measure_disk(os.path.dirname(os.path.abspath(filename))),
+        "dictionaries": {
+            "name": _average_length(names),
+            "surname": _average_length(SURNAMES),
+            "email_domain": _average_length(KNOWN_EMAIL_DOMAINS),
+            "word": _average_length(NATURAL_ENGLISH_WORDS),
+        },
+    }
+    with open(filename, "w") as f:
+        json.dump(calibration, f, indent=2)
+    return calibration
+
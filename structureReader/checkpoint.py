@@ -0,0 +1,188 @@
+from __future__ import annotations
+from typing import Any, Callable, TYPE_CHECKING
+import json
+import os
+import threading
+
+if TYPE_CHECKING:
+    from structureReader.writer import WritePipeline
+
+CHECKPOINT_VERSION = 1
+
+
+class CheckpointMismatch(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+class ResumableFile:
+    # binary file written as utf-8 text, which keeps track of its exact byte offset. With a pipeline the
+    # encoded text is written by a writer thread of its own, while the caller goes on generating
+    offset: int
+
+    def __init__(self, path: str, offset: int | None = None, pipeline: WritePipeline | None = None):
+        if offset is None:
+            self._file = open(path, "wb")
+            self.offset = 0
+        else:
+            # everything past the last checkpoint is a partially written batch
+            self._file = open(path, "r+b")
+            self._file.truncate(offset)
+            self._file.seek(offset)
+            self.offset = offset
+        self._writer = pipeline.writer(self._file, os.path.basename(path)) if pipeline else None
+
+    def write(self, text: str):
+        self.write_bytes(text.encode("utf-8"))
+
+    def write_rows(self, rows: list[str]) -> int:
+        data = "".join(rows).encode("utf-8")
+        self.write_bytes(data)
+        return len(data)
+
+    def write_bytes(self, data: bytes):
+        if self._writer is not None:
+            self._writer.put(data)
+        else:
+            self._file.write(data)
+        self.offset += len(data)
+
+    def position(self) -> dict[str, Any]:
+        return {"offset": self.offset}
+
+    def sync(self):
+        if self._writer is not None:
+            self._writer.drain()
+        self._file.flush()
+        os.fsync(self._file.fileno())
+
+    def durable(self, callback: Callable[[], None]):
+        # runs callback once everything written so far is on disk, which is later on a writer thread
+        if self._writer is not None:
+            self._writer.sync(callback)
+        else:
+            self.sync()
+            callback()
+
+    def close(self):
+        # the pipeline waits for the writer to finish, the caller does not
+        if self._writer is not None:
+            self._writer.close()
+        else:
+            self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+
+class Checkpoint:
+    # records, for every table, how many rows were completely written and the file offset right after them.
+    # It is removed once the run completes, which leaves nothing to resume
+    path: str
+    state: dict[str, Any]
+
+    def __init__(self, path: str, schema_digest: str, seed: int, dialect: str | None, chunk_rows: int, partitioning: str | None = None):
+        self.path = path
+        # records arrive from the writer threads of the files
+        self._lock = threading.Lock()
+        self.state = {
+            "version": CHECKPOINT_VERSION,
+            "schema_sha256": schema_digest,
+            "seed": seed,
+            "dialect": dialect,
+            "chunk_rows": chunk_rows,
+            "partitioning": partitioning,
+            "ddl_offset": None,
+            "constraints_offset": None,
+            "tables": {},
+        }
+
+    @staticmethod
+    def load(path: str) -> Checkpoint | None:
+        if not os.path.exists(path):
+            return None
+        with open(path, "r") as f:
+            state = json.load(f)
+        checkpoint = Checkpoint(path, state["schema_sha256"], state["seed"], state["dialect"], state["chunk_rows"])
+        checkpoint.state = state
+        return checkpoint
+
+    @staticmethod
+    def peek_seed(path: str) -> int | None:
+        checkpoint = Checkpoint.load(path)
+        return checkpoint.state["seed"] if checkpoint else None
+
+    def check_compatible(self, schema_digest: str, seed: int, dialect: str | None, chunk_rows: int, partitioning: str | None = None):
+        expected = {
+            "version": CHECKPOINT_VERSION,
+            "schema_sha256": schema_digest,
+            "seed": seed,
+            "dialect": dialect,
+            "chunk_rows": chunk_rows,
+            "partitioning": partitioning,
+        }
+        for key, value in expected.items():
+            if self.state.get(key) != value:
+                raise CheckpointMismatch(f"Cannot resume from {self.path}: '{key}' was {self.state.get(key)} but is now {value}")
+
+    def rows_done(self, table: str) -> int:
+        return self.state["tables"].get(table, {}).get("rows", 0)
+
+    def offset(self, table: str) -> int | None:
+        return self.state["tables"].get(table, {}).get("offset")
+
+    def position(self, table: str) -> dict[str, Any] | None:
+        # where the output of the table continues, the offset and for partitioned output the part
+        entry = self.state["tables"].get(table)
+        return {key: value for key, value in entry.items() if key not in ("rows", "statistics")} if entry else None
+
+    def statistics(self, table: str) -> dict[str, Any] | None:
+        # state of the column statistics of the rows done, for a table which is not complete
+        text = self.state["tables"].get(table, {}).get("statistics")
+        return json.loads(text) if text is not None else None
+
+    def last_offset(self) -> int | None:
+        offsets = [t["offset"] for t in self.state["tables"].values()]
+        for key in ("ddl_offset", "constraints_offset"):
+            if self.state.get(key) is not None:
+                offsets.append(self.state[key])
+        return max(offsets) if offsets else None
+
+    def record_ddl(self, out: ResumableFile):
+        offset = out.offset
+        out.durable(lambda: self._update(lambda: self.state.update(ddl_offset=offset)))
+
+    def record_constraints(self, out: ResumableFile):
+        offset = out.offset
+        out.durable(lambda: self._update(lambda: self.state.update(constraints_offset=offset)))
+
+    def record(self, table: str, rows: int, out: Any, statistics: str | None = None):
+        # data has to be on disk before the checkpoint that points past it. The statistics of the rows
+        # (their state as json text, which is large) are saved with them, so that a resumed run
+        # continues them rather than generating the rows again
+        entry = {"rows": rows, **out.position()}
+        if statistics is not None:
+            entry["statistics"] = statistics
+        out.durable(lambda: self._update(lambda: self.state["tables"].__setitem__(table, entry)))
+
+    def _update(self, change: Callable[[], None]):
+        with self._lock:
+            change()
+            self.save()
+
+    def remove(self):
+        with self._lock:
+            for path in (self.path, self.path + ".tmp"):
+                if os.path.exists(path):
+                    os.remove(path)
+
+    def save(self):
+        with open(self.path + ".tmp", "w") as f:
+            json.dump(self.state, f, indent=2)
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(self.path + ".tmp", self.path)
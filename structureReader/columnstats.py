@@ -0,0 +1,364 @@
+from __future__ import annotations
+from array import array
+from collections import Counter
+from datetime import datetime
+from itertools import starmap
+from operator import itemgetter
+from typing import Any, Iterable, TYPE_CHECKING
+from dataGenerators.dictionary import EncodedColumn
+from instrumentation.profiler import PROFILER
+from typeWrappers.types import DbType
+import json
+import math
+import os
+import struct
+import sys
+import zlib
+
+if TYPE_CHECKING:
+    from structureReader.reader import DbTable
+
+# 2^12 HyperLogLog registers, distinct counts are estimated within about 1.6%
+HLL_PRECISION = 12
+# rows of every table sampled for its histograms, one per stretch of rows of the same length
+SAMPLE_ROWS = 16384
+HISTOGRAM_BUCKETS = 32
+TOP_VALUES = 10
+# columns with at most this many distinct values count every one of them, the top values of the
+# others are estimated from the sample
+COUNTED_VALUES = 256
+# distinct values kept to count them exactly, columns with more are counted by the registers
+EXACT_DISTINCT = 16384
+
+_M64 = (1 << 64) - 1
+_REGISTERS = 1 << HLL_PRECISION
+_INDEX_MASK = _REGISTERS - 1
+# bits of a (positive, 63 bits) hash left for the rank once the register index is taken
+_RANK_BITS = 63 - HLL_PRECISION
+
+
+def _fmix(z: int) -> int:
+    # the murmur3 finalizer, spreads sequential values over all the bits
+    z = ((z ^ (z >> 33)) * 0xFF51AFD7ED558CCD) & _M64
+    return ((z ^ (z >> 33)) * 0xC4CEB9FE1A85EC53) & _M64
+
+
+def _checksums(db_type: DbType, values: Iterable[Any]) -> Iterable[int]:
+    # crc32 of the bytes of every value. hash() is salted per process for strings and dates, but shards
+    # and sort workers have to fill the same registers. Everything runs in C, a loop over the values
+    # would cost more than generating them
+    if db_type == DbType.STRING:
+        return map(zlib.crc32, map(str.encode, values))
+    if db_type == DbType.DATE:
+        # a naive datetime pickles to its 10 bytes
+        return starmap(zlib.crc32, map(itemgetter(1), map(datetime.__reduce__, values)))
+    try:
+        packed = array("q" if db_type == DbType.INTEGER else "d", values)
+    except (OverflowError, TypeError):
+        return map(zlib.crc32, map(str.encode, map(repr, values)))
+    if sys.byteorder == "big":
+        packed.byteswap()
+    return starmap(zlib.crc32, struct.iter_unpack("8s", packed))
+
+
+def _encode(db_type: DbType, value: Any) -> Any:
+    return str(value) if db_type == DbType.DATE and value is not None else value
+
+
+def _decode(db_type: DbType, value: Any) -> Any:
+    return datetime.fromisoformat(value) if db_type == DbType.DATE and value is not None else value
+
+
+class ColumnStatistics:
+    # sketches of one column, filled a batch at a time and mergeable with those of other processes:
+    # exact row, NULL, min and max counts, the distinct values (HyperLogLog registers once there are
+    # too many of them), the count of every value of columns with few of them and the values of the
+    # sampled rows
+    name: str
+    type: DbType
+    unique: bool  # the generator never repeats a value, distinct values are counted without sketches
+    rows: int
+    nulls: int
+    minimum: Any
+    maximum: Any
+    distinct_values: set[Any] | None  # None once the column is counted by the registers
+    registers: bytearray
+    counts: dict[Any, int] | None  # None once the column has too many distinct values
+    sample: list[Any]
+
+    def __init__(self, name: str, db_type: DbType, unique: bool = False):
+        self.name = name
+        self.type = db_type
+        self.unique = unique
+        self.rows = 0
+        self.nulls = 0
+        self.minimum = None
+        self.maximum = None
+        self.distinct_values = set()
+        self.registers = bytearray(_REGISTERS)
+        self.counts = None if unique else {}
+        self.sample = []
+
+    def add(self, values: list[Any], sample_positions: list[int]):
+        self.rows += len(values)
+        if self.unique:
+            nulls = values.count(None)
+            present = [value for value in values if value is not None] if nulls else values
+            self.nulls += nulls
+            if present:
+                self._add_bounds(min(present), max(present))
+        else:
+            # every distinct value of the batch is only compared and hashed once
+            distinct = self._add_counted(values) if self.counts is not None else self._distinct(values)
+            if distinct:
+                self._add_bounds(min(distinct), max(distinct))
+                self._add_distinct(distinct)
+        self.sample.extend(value for value in map(values.__getitem__, sample_positions) if value is not None)
+
+    def _distinct(self, values: list[Any]) -> set[Any]:
+        if isinstance(values, EncodedColumn):
+            lookup = values.dictionary.lookup
+            distinct = set(map(lookup.__getitem__, set(values.codes)))
+        else:
+            distinct = set(values)
+        if None in distinct:
+            distinct.discard(None)
+            self.nulls += values.count(None)
+        return distinct
+
+    def _add_counted(self, values: list[Any]) -> Iterable[Any]:
+        if isinstance(values, EncodedColumn):
+            lookup = values.dictionary.lookup
+            counts: dict[Any, int] = {lookup[code]: count for code, count in Counter(values.codes).items()}
+        else:
+            counts = Counter(values)
+        self.nulls += counts.pop(None, 0)
+        self._add_counts(counts)
+        return counts.keys()
+
+    def _add_counts(self, counts: dict[Any, int]):
+        summary = self.counts
+        if summary is None:
+            return
+        if len(counts) > COUNTED_VALUES or len(summary.keys() | counts.keys()) > COUNTED_VALUES:
+            self.counts = None
+            return
+        for value, count in counts.items():
+            summary[value] = summary.get(value, 0) + count
+
+    def _add_bounds(self, low: Any, high: Any):
+        if self.minimum is None or low < self.minimum:
+            self.minimum = low
+        if self.maximum is None or high > self.maximum:
+            self.maximum = high
+
+    def _add_distinct(self, values: Iterable[Any]):
+        if self.distinct_values is None:
+            self._add_hashes(values)
+            return
+        self.distinct_values.update(values)
+        if len(self.distinct_values) > EXACT_DISTINCT:
+            self._add_hashes(self.distinct_values)
+            self.distinct_values = None
+
+    def _add_hashes(self, values: Iterable[Any]):
+        # the checksums are mixed by hashing them in a tuple (not salted for ints, and not linear like crc32).
+        # The low bits of a hash pick its register and the rank is counted in the others: only hashes small
+        # enough to raise the lowest register get past the filter, later batches hardly leave C
+        registers = self.registers
+        threshold = 1 << (63 - min(registers))
+        for h in filter(range(1 - threshold, threshold).__contains__, map(hash, zip(_checksums(self.type, values)))):
+            h = abs(h)
+            index = h & _INDEX_MASK
+            rank = _RANK_BITS + 1 - (h >> HLL_PRECISION).bit_length()
+            if rank > registers[index]:
+                registers[index] = rank
+
+    def merge(self, other: ColumnStatistics):
+        self.rows += other.rows
+        self.nulls += other.nulls
+        if other.minimum is not None:
+            self._add_bounds(other.minimum, other.maximum)
+        if other.distinct_values is not None:
+            self._add_distinct(other.distinct_values)
+        else:
+            if self.distinct_values is not None:
+                self._add_hashes(self.distinct_values)
+                self.distinct_values = None
+            self.registers = bytearray(map(max, self.registers, other.registers))
+        if other.counts is None:
+            self.counts = None
+        else:
+            self._add_counts(other.counts)
+        self.sample.extend(other.sample)
+
+    def distinct(self) -> int:
+        if self.unique:
+            return self.rows - self.nulls
+        if self.distinct_values is not None:
+            return len(self.distinct_values)
+        m = _REGISTERS
+        estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum(2.0 ** -rank for rank in self.registers)
+        zeros = self.registers.count(0)
+        if estimate <= 2.5 * m and zeros:
+            # linear counting is more accurate for few values
+            estimate = m * math.log(m / zeros)
+        return max(1, min(round(estimate), self.rows - self.nulls))
+
+    def histogram(self) -> dict[str, Any] | None:
+        # equi-depth: every bucket holds about the same number of rows, bounds come from the sample
+        # and the first and last one are the exact min and max
+        if not self.sample:
+            return None
+        sample = sorted(self.sample)
+        buckets = min(HISTOGRAM_BUCKETS, len(sample))
+        bounds = [sample[len(sample) * i // buckets] for i in range(buckets)] + [self.maximum]
+        bounds[0] = self.minimum
+        return {
+            "bounds": [_encode(self.type, bound) for bound in bounds],
+            "rows_per_bucket": (self.rows - self.nulls) / buckets,
+        }
+
+    def top_values(self) -> tuple[list[tuple[Any, int]], bool]:
+        # the most frequent values (seen more than once) with their counts, and whether the counts are exact
+        if self.unique:
+            return [], True
+        exact = self.counts is not None or len(self.sample) == self.rows - self.nulls
+        if self.counts is not None:
+            counts = Counter(self.counts)
+            scale = 1.0
+        else:
+            counts = Counter(self.sample)
+            scale = (self.rows - self.nulls) / len(self.sample) if self.sample else 0.0
+        return [(value, round(count * scale)) for value, count in counts.most_common(TOP_VALUES) if count > 1], exact
+
+    def summary(self) -> dict[str, Any]:
+        top, top_exact = self.top_values()
+        return {
+            "type": self.type.name.lower(),
+            "rows": self.rows,
+            "nulls": self.nulls,
+            "null_fraction": self.nulls / self.rows if self.rows else 0.0,
+            "min": _encode(self.type, self.minimum),
+            "max": _encode(self.type, self.maximum),
+            "distinct": self.distinct() if self.rows > self.nulls else 0,
+            "distinct_exact": self.unique or self.distinct_values is not None,
+            "histogram": self.histogram(),
+            "top_values": [
+                {"value": _encode(self.type, value), "count": count, "fraction": count / self.rows}
+                for value, count in top
+            ],
+            "top_values_exact": top_exact,
+        }
+
+    def state(self) -> dict[str, Any]:
+        # everything merge() needs, as json
+        return {
+            "name": self.name,
+            "type": self.type.name,
+            "unique": self.unique,
+            "rows": self.rows,
+            "nulls": self.nulls,
+            "min": _encode(self.type, self.minimum),
+            "max": _encode(self.type, self.maximum),
+            "distinct_values": [_encode(self.type, value) for value in self.distinct_values] if self.distinct_values is not None else None,
+            "registers": self.registers.hex(),
+            "counts": [[_encode(self.type, value), count] for value, count in self.counts.items()] if self.counts is not None else None,
+            "sample": [_encode(self.type, value) for value in self.sample],
+        }
+
+    @staticmethod
+    def from_state(state: dict[str, Any]) -> ColumnStatistics:
+        db_type = DbType[state["type"]]
+        column = ColumnStatistics(state["name"], db_type, state["unique"])
+        column.rows = state["rows"]
+        column.nulls = state["nulls"]
+        column.minimum = _decode(db_type, state["min"])
+        column.maximum = _decode(db_type, state["max"])
+        if state["distinct_values"] is not None:
+            column.distinct_values = {_decode(db_type, value) for value in state["distinct_values"]}
+        else:
+            column.distinct_values = None
+        column.registers = bytearray.fromhex(state["registers"])
+        if state["counts"] is not None:
+            column.counts = {_decode(db_type, value): count for value, count in state["counts"]}
+        else:
+            column.counts = None
+        column.sample = [_decode(db_type, value) for value in state["sample"]]
+        return column
+
+
+class TableStatistics:
+    # the statistics of every column of a table, gathered from its batches as they are generated.
+    # Rows are sampled by position, so the sample (and with it the histograms) is the same whichever
+    # process generated which rows
+    table: str
+    columns: dict[str, ColumnStatistics]
+    sampled: int
+
+    def __init__(self, table: str, quantity: int, seed: int, columns: dict[str, ColumnStatistics], sampled: int = 0):
+        self.table = table
+        self.columns = columns
+        self.sampled = sampled
+        self._quantity = quantity
+        self._seed = seed
+        self._stride = max(1, -(-quantity // SAMPLE_ROWS))
+
+    @staticmethod
+    def of(table: DbTable) -> TableStatistics:
+        columns = {name: ColumnStatistics(name, attribute.type, table.unique_values(attribute)) for name, attribute in table._attributes.items()}
+        return TableStatistics(table._name, table._quantity, table._seed, columns)
+
+    def _sample_positions(self, lo: int, hi: int) -> list[int]:
+        # one row of every stretch of stride rows, at a position of its own so that patterns repeating
+        # every few rows are not always sampled at the same point
+        stride = self._stride
+        positions = []
+        for stretch in range(lo // stride, (hi + stride - 1) // stride):
+            row = stretch * stride + _fmix(self._seed ^ stretch) % stride
+            if lo <= row < hi:
+                positions.append(row - lo)
+        return positions
+
+    def add(self, columns: dict[str, list[Any]], lo: int, hi: int):
+        with PROFILER.stage("statistics", self.table) as scope:
+            positions = self._sample_positions(lo, hi)
+            self.sampled += len(positions)
+            for name, column in self.columns.items():
+                column.add(columns[name], positions)
+            scope.add(rows=hi - lo)
+
+    def merge(self, other: TableStatistics):
+        self.sampled += other.sampled
+        for name, column in self.columns.items():
+            column.merge(other.columns[name])
+
+    def summary(self) -> dict[str, Any]:
+        return {
+            "table": self.table,
+            "rows": self._quantity,
+            "sampled_rows": self.sampled,
+            "columns": {name: column.summary() for name, column in self.columns.items()},
+        }
+
+    def write(self, path: str):
+        with open(path, "w") as f:
+            json.dump(self.summary(), f, indent=2)
+
+    def state(self) -> dict[str, Any]:
+        return {
+            "table": self.table,
+            "rows": self._quantity,
+            "seed": self._seed,
+            "sampled": self.sampled,
+            "columns": [column.state() for column in self.columns.values()],
+        }
+
+    @staticmethod
+    def from_state(state: dict[str, Any]) -> TableStatistics:
+        columns = {column["name"]: ColumnStatistics.from_state(column) for column in state["columns"]}
+        return TableStatistics(state["table"], state["rows"], state["seed"], columns, state["sampled"])
+
+
+def statistics_path(directory: str, table: str) -> str:
+    return os.path.join(directory, f"{table}.stats.json")
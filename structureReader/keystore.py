@@ -0,0 +1,251 @@
+from __future__ import annotations
+from typeWrappers.types import DbType
+from datetime import datetime, timedelta
+from array import array
+from typing import Any, BinaryIO
+import atexit
+import glob
+import mmap
+import os
+import shutil
+import tempfile
+
+if os.name == "nt":
+    import msvcrt
+else:
+    import fcntl
+
+# dates are stored as microseconds since this instant
+_DATE_EPOCH = datetime(1, 1, 1)
+_MICROSECOND = timedelta(microseconds=1)
+# typecodes of the fixed width layouts, strings use an offset index instead
+_TYPECODES = {
+    DbType.INTEGER: "q",
+    DbType.REAL: "d",
+    DbType.DATE: "q",
+}
+
+
+def _map(f: BinaryIO) -> tuple[mmap.mmap | None, memoryview | None]:
+    if os.fstat(f.fileno()).st_size == 0:
+        # empty files cannot be mapped
+        return None, None
+    mapped = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    return mapped, memoryview(mapped)
+
+
+def _try_lock(f: BinaryIO) -> bool:
+    # exclusive lock held as long as the file is open, which the system releases when the process dies
+    try:
+        if os.name == "nt":
+            msvcrt.locking(f.fileno(), msvcrt.LK_NBLCK, 1)
+        else:
+            fcntl.flock(f.fileno(), fcntl.LOCK_EX | fcntl.LOCK_NB)
+    except OSError:
+        return False
+    return True
+
+
+def _remove_abandoned(directory: str):
+    # the key directory of a run which was killed, its lock is free. A directory without a lock file
+    # is still being created
+    try:
+        lock = open(os.path.join(directory, ".lock"), "rb")
+    except OSError:
+        return
+    with lock:
+        abandoned = _try_lock(lock)
+    if abandoned:
+        shutil.rmtree(directory, ignore_errors=True)
+
+
+class KeyColumn:
+    # read only, memory mapped column of keys, supports len() and random access by row.
+    # Other processes can map the same column from its path, unless its files were unlinked (path is None)
+    path: str | None
+    _type: DbType
+    _count: int
+
+    def __init__(self, path: str | None, db_type: DbType, count: int, files: list[BinaryIO] | None = None):
+        # files are the open spill files when the column was just written, mapped without opening them again
+        self.path = path
+        self._type = db_type
+        self._count = count
+        self._maps: list[mmap.mmap] = []
+        self._views: list[memoryview] = []
+        opened = iter(files) if files is not None else None
+        if db_type == DbType.STRING:
+            self._data = self._open(path + ".str" if opened is None else next(opened), None)  # type: ignore
+            self._offsets = self._open(path + ".idx" if opened is None else next(opened), "Q")  # type: ignore
+        else:
+            self._values = self._open(path if opened is None else next(opened), _TYPECODES[db_type])  # type: ignore
+
+    def _open(self, file: str | BinaryIO, typecode: str | None) -> memoryview | None:
+        if isinstance(file, str):
+            with open(file, "rb") as f:
+                mapped, view = _map(f)
+        else:
+            with file:
+                mapped, view = _map(file)
+        if mapped is None or view is None:
+            return None
+        self._maps.append(mapped)
+        self._views.append(view)
+        if typecode is not None:
+            view = view.cast(typecode)
+            self._views.append(view)
+        return view
+
+    @property
+    def type(self) -> DbType:
+        return self._type
+
+    def __len__(self) -> int:
+        return self._count
+
+    def __getitem__(self, index: int) -> Any:
+        if index < 0 or index >= self._count:
+            raise IndexError(f"key index {index} out of range")
+        if self._type == DbType.STRING:
+            start = self._offsets[index]  # type: ignore
+            end = self._offsets[index + 1]  # type: ignore
+            return bytes(self._data[start:end]).decode("utf-8") if end > start else ""  # type: ignore
+        value = self._values[index]  # type: ignore
+        if self._type == DbType.DATE:
+            return _DATE_EPOCH + value * _MICROSECOND
+        return value
+
+    def take(self, indexes: list[int]) -> list[Any]:
+        # the keys of many rows at once, fixed width values are read without going through __getitem__
+        if self._type == DbType.STRING:
+            return list(map(self.__getitem__, indexes))
+        values = list(map(self._values.__getitem__, indexes))  # type: ignore
+        if self._type == DbType.DATE:
+            return list(map(_DATE_EPOCH.__add__, map(_MICROSECOND.__mul__, values)))
+        return values
+
+    def close(self):
+        # views have to be released before their maps can be closed
+        for view in reversed(self._views):
+            view.release()
+        for mapped in self._maps:
+            mapped.close()
+        self._views.clear()
+        self._maps.clear()
+
+
+class KeyColumnWriter:
+    # appends the values of a key column to its spill file(s) as they are generated. Unless other
+    # processes have to map them, the files are unlinked once opened (where the system allows it),
+    # so that nothing is left behind when the run is killed
+    path: str
+    rows: int
+
+    def __init__(self, path: str, db_type: DbType, unlink: bool = False):
+        self.path = path
+        self.rows = 0
+        self._type = db_type
+        if db_type == DbType.STRING:
+            self._file = open(path + ".str", "w+b")
+            self._index = open(path + ".idx", "w+b")
+            self._offset = 0
+        else:
+            self._file = open(path, "w+b")
+            self._index = None
+        self._unlinked = unlink and os.name == "posix"
+        if self._unlinked:
+            for f in self._files():
+                os.unlink(f.name)
+
+    def _files(self) -> list[BinaryIO]:
+        return [self._file, self._index] if self._index is not None else [self._file]
+
+    def append(self, values: list[Any]):
+        if self._type == DbType.STRING:
+            offsets = array("Q")
+            for value in values:
+                data = value.encode("utf-8")
+                offsets.append(self._offset)
+                self._file.write(data)
+                self._offset += len(data)
+            self._index.write(offsets.tobytes())  # type: ignore
+        elif self._type == DbType.DATE:
+            self._file.write(array("q", ((value - _DATE_EPOCH) // _MICROSECOND for value in values)).tobytes())
+        else:
+            try:
+                self._file.write(array(_TYPECODES[self._type], values).tobytes())
+            except OverflowError:
+                raise ValueError(f"Key column {self.path} has values which do not fit in 64 bits")
+        self.rows += len(values)
+
+    def finish(self) -> KeyColumn:
+        if self._index is not None:
+            # the end of the last string
+            self._index.write(array("Q", [self._offset]).tobytes())
+        for f in self._files():
+            f.flush()
+        return KeyColumn(None if self._unlinked else self.path, self._type, self.rows, self._files())
+
+    def discard(self):
+        if self._index is not None:
+            self._index.close()
+        self._file.close()
+
+
+class KeyStore:
+    # directory holding the spilled key columns of a schema, removed when the process exits. The
+    # directories of killed runs are removed by the next run creating one in the same place
+    shared: bool  # other processes (sort workers) map the columns from their paths
+    _prefix: str
+    _directory: str | None
+
+    def __init__(self, prefix: str, parent: str | None = None):
+        self.shared = True
+        self._prefix = prefix
+        self._parent = parent
+        self._directory = None
+        self._lock: BinaryIO | None = None
+        self._columns: list[KeyColumn] = []
+        self._writers: list[KeyColumnWriter] = []
+
+    def _create_directory(self) -> str:
+        # next to the output rather than in the system temp directory, which is often in memory
+        parent = self._parent or os.getcwd()
+        for abandoned in glob.glob(os.path.join(glob.escape(parent), f".{glob.escape(self._prefix)}-keys-*")):
+            _remove_abandoned(abandoned)
+        directory = tempfile.mkdtemp(prefix=f".{self._prefix}-keys-", dir=parent)
+        self._lock = open(os.path.join(directory, ".lock"), "wb")
+        _try_lock(self._lock)
+        atexit.register(self.close)
+        return directory
+
+    def writer(self, table: str, attribute: str, db_type: DbType) -> KeyColumnWriter:
+        if self._directory is None:
+            self._directory = self._create_directory()
+        writer = KeyColumnWriter(os.path.join(self._directory, f"{table}.{attribute}.keys"), db_type, unlink=not self.shared)
+        self._writers.append(writer)
+        return writer
+
+    def finish(self, writer: KeyColumnWriter) -> KeyColumn:
+        self._writers.remove(writer)
+        column = writer.finish()
+        self._columns.append(column)
+        return column
+
+    def discard(self, writer: KeyColumnWriter):
+        self._writers.remove(writer)
+        writer.discard()
+
+    def close(self):
+        for writer in self._writers:
+            writer.discard()
+        for column in self._columns:
+            column.close()
+        self._writers.clear()
+        self._columns.clear()
+        if self._lock is not None:
+            self._lock.close()
+            self._lock = None
+        if self._directory is not None:
+            shutil.rmtree(self._directory, ignore_errors=True)
+            self._directory = None
@@ -0,0 +1,229 @@
+from __future__ import annotations
+from typing import Any, Callable, TYPE_CHECKING
+from structureReader.checkpoint import ResumableFile
+from bisect import bisect_right
+from itertools import accumulate
+import glob
+import math
+import os
+
+if TYPE_CHECKING:
+    from structureReader.reader import DbSchema, DbTable
+    from structureReader.writer import WritePipeline
+
+
+class InvalidPartitioning(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+class PartitionSpec:
+    # how the output of every table is cut into part files: into a number of parts, into parts of at most
+    # some rows or at most some bytes. When several are given the smallest parts win
+    parts: int | None
+    max_rows: int | None
+    max_bytes: int | None
+
+    def __init__(self, parts: int | None = None, max_rows: int | None = None, max_megabytes: float | None = None):
+        for name, value in (("parts", parts), ("part rows", max_rows), ("part size", max_megabytes)):
+            if value is not None and value <= 0:
+                raise InvalidPartitioning(f"Number of {name} must be positive" if name == "parts" else f"{name.capitalize()} must be positive")
+        self.parts = parts
+        self.max_rows = max_rows
+        self.max_bytes = max(1, int(max_megabytes * 1024 * 1024)) if max_megabytes is not None else None
+
+    def rows_per_part(self, quantity: int) -> int | None:
+        limits = [self.max_rows] if self.max_rows is not None else []
+        if self.parts is not None:
+            limits.append(max(1, math.ceil(quantity / self.parts)))
+        return min(limits) if limits else None
+
+    def describe(self) -> str:
+        # stored in checkpoints, resuming with different parts would mix two layouts
+        return f"parts={self.parts},rows={self.max_rows},bytes={self.max_bytes}"
+
+
+def part_path(directory: str, table: str, part: int, extension: str) -> str:
+    return os.path.join(directory, f"{table}.part-{part:04d}.{extension}")
+
+
+class PartitionedFile:
+    # the output of one table cut into part files after a complete row.
+    # Every part starts with the header. It is written like a ResumableFile, offset is the one of the
+    # current part and position() holds what a checkpoint needs to resume it
+    part: int
+    part_rows: int
+
+    def __init__(self, directory: str, table: str, extension: str, header: str, spec: PartitionSpec, quantity: int,
+                 position: dict[str, Any] | None = None, pipeline: WritePipeline | None = None):
+        self._directory = directory
+        self._table = table
+        self._extension = extension
+        self._header = header.encode("utf-8")
+        self._max_rows = spec.rows_per_part(quantity)
+        self._max_bytes = spec.max_bytes
+        self._pipeline = pipeline
+        if position is None:
+            # parts of an earlier run with more of them would be loaded too
+            for stale in glob.glob(os.path.join(glob.escape(directory), f"{glob.escape(table)}.part-*.{extension}")):
+                os.remove(stale)
+            self.part = 0
+            self.part_rows = 0
+            self._out = self._open(None)
+        else:
+            self.part = position["part"]
+            self.part_rows = position["part_rows"]
+            self._out = self._open(position["offset"])
+
+    def _open(self, offset: int | None) -> ResumableFile:
+        out = ResumableFile(part_path(self._directory, self._table, self.part, self._extension), offset, self._pipeline)
+        if offset is None and self._header:
+            out.write_bytes(self._header)
+        return out
+
+    def _next_part(self):
+        # the previous parts have to be on disk before a checkpoint points into a later one
+        self._out.sync()
+        self._out.close()
+        self.part += 1
+        self.part_rows = 0
+        self._out = self._open(None)
+
+    @property
+    def offset(self) -> int:
+        return self._out.offset
+
+    def position(self) -> dict[str, Any]:
+        return {"offset": self._out.offset, "part": self.part, "part_rows": self.part_rows}
+
+    def write_rows(self, rows: list[str]) -> int:
+        # parts are cut between the rows handed over, a quoted value may hold a newline
+        text = "".join(rows)
+        data = text.encode("utf-8")
+        lengths = map(len, rows) if len(data) == len(text) else (len(row.encode("utf-8")) for row in rows)
+        ends = list(accumulate(lengths))
+        row = 0
+        start = 0
+        while row < len(ends):
+            last = len(ends)
+            if self._max_rows is not None:
+                last = min(last, row + self._max_rows - self.part_rows)
+            if self._max_bytes is not None:
+                last = bisect_right(ends, start + self._max_bytes - self.offset, row, last)
+                if last == row and self.part_rows == 0:
+                    # a row larger than a part gets a part of its own
+                    last = row + 1
+            if last > row:
+                self._out.write_bytes(data[start:ends[last - 1]])
+                self.part_rows += last - row
+                row, start = last, ends[last - 1]
+            if row < len(ends):
+                self._next_part()
+        return len(data)
+
+    def sync(self):
+        self._out.sync()
+
+    def durable(self, callback: Callable[[], None]):
+        self._out.durable(callback)
+
+    def close(self):
+        self._out.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+
+def load_levels(schema: DbSchema) -> list[list[DbTable]]:
+    # selected tables grouped so that every table comes after the tables its foreign keys reference
+    selected = {table._name: table for table in schema.selected_tables}
+    levels: dict[str, int] = {}
+
+    def level(table: DbTable, visiting: set[str]) -> int:
+        if table._name in levels:
+            return levels[table._name]
+        visiting.add(table._name)
+        parents = {
+            attribute._references.table._name  # type: ignore
+            for attribute in table._attributes.values()
+            if attribute._references and not isinstance(attribute._references.table, str)
+        }
+        depth = 0
+        for name in parents:
+            if name in selected and name not in visiting:
+                depth = max(depth, level(selected[name], visiting) + 1)
+        visiting.discard(table._name)
+        levels[table._name] = depth
+        return depth
+
+    for table in selected.values():
+        level(table, set())
+    grouped: list[list[DbTable]] = [[] for _ in range(max(levels.values(), default=-1) + 1)]
+    for table in selected.values():
+        grouped[levels[table._name]].append(table)
+    return grouped
+
+
+# how every dialect runs a script file ($1) and loads a part ($2 table, $3 file)
+_LOADERS = {
+    ("postgres", "csv"): (
+        "# the connection is taken from the PG* environment variables (PGHOST, PGDATABASE, PGUSER, ...)",
+        'psql -X -q -v ON_ERROR_STOP=1 -f "$1"',
+        'exec psql -X -q -v ON_ERROR_STOP=1 -c "\\\\copy $2 FROM \'$3\' WITH (FORMAT csv, HEADER true)"',
+    ),
+    ("postgres", "sql"): (
+        "# the connection is taken from the PG* environment variables (PGHOST, PGDATABASE, PGUSER, ...)",
+        'psql -X -q -v ON_ERROR_STOP=1 -f "$1"',
+        'exec psql -X -q -v ON_ERROR_STOP=1 -1 -f "$3"',
+    ),
+    ("oracle", "sql"): (
+        "# the connection is taken from ORACLE_CONNECT (user/password@service)",
+        'printf \'WHENEVER SQLERROR EXIT FAILURE ROLLBACK\\n@%s\\nexit\\n\' "$1" | sqlplus -S -L "$ORACLE_CONNECT"',
+        'printf \'WHENEVER SQLERROR EXIT FAILURE ROLLBACK\\n@%s\\nCOMMIT;\\nexit\\n\' "$3" | sqlplus -S -L "$ORACLE_CONNECT"; exit',
+    ),
+}
+
+
+def write_load_script(schema: DbSchema, directory: str, extension: str, dialect: str) -> str:
+    # a shell script creating the tables, loading the parts of the tables of every level in parallel and then
+    # adding the constraints. Part files are listed when it runs
+    if (dialect, extension) not in _LOADERS:
+        raise InvalidPartitioning(f"There is no load script for {extension} output in the {dialect} dialect")
+    connection, run_file, load_part = _LOADERS[(dialect, extension)]
+    lines = [
+        "#!/bin/sh",
+        f"# loads the {extension} parts of schema {schema._name} with up to JOBS parallel sessions: {os.path.basename(load_script_path(directory, extension))} [JOBS]",
+        connection,
+        "set -e",
+        'cd "$(dirname "$0")"',
+        'SCRIPT="$(pwd)/$(basename "$0")"',
+        'run_file() {',
+        f"    {run_file}",
+        "}",
+        'if [ "$1" = "--part" ]; then',
+        f"    {load_part}",
+        "fi",
+        'JOBS="${1:-4}"',
+        f"run_file {dialect}.ddl.sql",
+        "# tables referenced by foreign keys are loaded before the tables referencing them",
+    ]
+    for tables in load_levels(schema):
+        names = " ".join(table._name for table in tables)
+        lines.append(
+            f'for table in {names}; do for part in "$table".part-*.{extension}; do echo "$table $part"; done; done'
+            f' | xargs -P "$JOBS" -n 2 "$SCRIPT" --part'
+        )
+    lines.append(f"run_file {dialect}.constraints.sql")
+    path = load_script_path(directory, extension)
+    with open(path, "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+    os.chmod(path, 0o755)
+    return path
+
+
+def load_script_path(directory: str, extension: str) -> str:
+    return os.path.join(directory, f"load-{extension}.sh")
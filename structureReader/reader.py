@@ -3,17 +3,59 @@ from enum import IntEnum
 from io import TextIOWrapper
 import json
 from typeWrappers.types import DbType
-from typing import Any
-from dataGenerators.generators import value_generator_factory, GenerationMode
+from typing import Any, TYPE_CHECKING
+from dataGenerators.generators import value_generator_factory, derive_seed, GenerateString, GenerationMode
+from dataGenerators.expression import CompiledExpression, InvalidExpression
+from dataGenerators.distributions import Distribution, InvalidDistribution, parse_distribution
+from dataGenerators.dictionary import EncodedColumn, InvalidDictionary, ValueDictionary, parse_dictionary
+from dataGenerators.timeseries import EventStream, InvalidTimeSeries, TimeSeriesSpec, parse_time_series
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR
+from structureReader.checkpoint import Checkpoint, CheckpointMismatch, ResumableFile
+from structureReader.keystore import KeyStore, KeyColumn, KeyColumnWriter
+from structureReader.sort import write_sorted
+from structureReader.writer import WritePipeline, RowLines, DEFAULT_WRITE_BUFFERS
+from structureReader.partition import PartitionedFile, PartitionSpec, write_load_script
+from structureReader.columnstats import TableStatistics, statistics_path
+from contextlib import ExitStack
 from datetime import datetime, timedelta
-from csv import DictWriter
+from itertools import chain
+from operator import itemgetter
+import hashlib
+import io
 import os
 import random
 
+if TYPE_CHECKING:
+    from structureReader.worker import RowCache
+
+# rows are generated in chunks of this size, each with its own seeded rng,
+# so that any row range can be regenerated identically in any process
+CHUNK_ROWS = 4096
+# rows generated and written at once, a checkpoint is taken after each batch
+DEFAULT_BATCH_CHUNKS = 16
+
 class SQLDialect(IntEnum):
     POSTGRES = 1
     ORACLE = 2
 
+map_str_to_dialect = {
+    "postgres": SQLDialect.POSTGRES,
+    "oracle": SQLDialect.ORACLE,
+}
+
+
+class ScalingMode(IntEnum):
+    LINEAR = 1
+    FIXED = 2
+    PROPORTIONAL = 3
+
+map_str_to_scaling_mode = {
+    "LINEAR": ScalingMode.LINEAR,
+    "FIXED": ScalingMode.FIXED,
+    "PROPORTIONAL": ScalingMode.PROPORTIONAL,
+}
+
 map_str_to_type = {
     "INTEGER": DbType.INTEGER,
     "STRING": DbType.STRING,
@@ -29,6 +71,8 @@ map_str_to_generation_type = {
     "EMAIL": GenerationMode.EMAIL,
     "PHONE": GenerationMode.PHONE,
     "NATURALTEXT": GenerationMode.NATURALTEXT,
+    "EXPRESSION": GenerationMode.EXPRESSION,
+    "ENUM": GenerationMode.ENUM,
 }
 
 
@@ -50,7 +94,7 @@ def construct_timedelta(object: dict[str, str]):
     return timedelta(*values)
 
 
-def make_sql_type_from_type(type: DbType, length: int, dialect: SQLDialect):
+def make_sql_type_from_type(type: DbType, length: int, dialect: SQLDialect, time_of_day: bool = False):
     if dialect == SQLDialect.POSTGRES:
         match type:
             case DbType.INTEGER:
@@ -60,7 +104,7 @@ def make_sql_type_from_type(type: DbType, length: int, dialect: SQLDialect):
             case DbType.STRING:
                 return f"VARCHAR({length})"
             case DbType.DATE:
-                return "DATE"
+                return "TIMESTAMP" if time_of_day else "DATE"
     elif dialect == SQLDialect.ORACLE:
         match type:
             case DbType.INTEGER | DbType.REAL:
@@ -71,6 +115,34 @@ def make_sql_type_from_type(type: DbType, length: int, dialect: SQLDialect):
                 return "TIMESTAMP"
 
 
+def sql_literal(type: DbType, value: Any, dialect: SQLDialect) -> str:
+    if value is None:
+        return "NULL"
+    if type == DbType.STRING:
+        return "'" + value.replace("'", "''") + "'"
+    elif type == DbType.DATE:
+        if dialect == SQLDialect.POSTGRES:
+            return f"'{value}'"
+        elif dialect == SQLDialect.ORACLE:
+            # time series timestamps have microseconds, str() only shows them when they are not 0
+            text = value.isoformat(sep=" ", timespec="microseconds") if isinstance(value, datetime) else value
+            return f"TO_TIMESTAMP('{text}', 'YYYY-MM-DD HH24:MI:SS.FF6')"
+        else:
+            raise ValueError(f"Invalid dialect {dialect}")
+    return str(value)
+
+
+def _csv_cell(value: Any) -> str:
+    # a value as the csv writer writes it: NULL is an empty field and text containing
+    # a separator, a quote or a line break is quoted
+    if value is None:
+        return ""
+    text = str(value)
+    if '"' in text or "," in text or "\n" in text or "\r" in text:
+        return '"' + text.replace('"', '""') + '"'
+    return text
+
+
 map_starting_to_cast = {
     DbType.INTEGER: int,
     DbType.REAL: float,
@@ -115,12 +187,41 @@ class DbAttribute:
     _step: Any  # not valid for strings
     _length: None | int  # valid only for strings
     _generation: GenerationMode
-    _data: None | list[Any]
+    _data: None | list[Any] | KeyColumn
     _references: None | References
+    _seed: int
+    _scale_domain: bool | None  # None means only if the attribute is a primary key
+    _expression_text: str | None
+    _expression: CompiledExpression | None
+    _explicit_length: bool
+    _distribution_spec: Any  # as given in the schema, rebuilt when the step is scaled
+    _distribution: Distribution | None
+    _null_fraction: float
+    _dictionary: ValueDictionary | None
+    _time_of_day: bool  # dates which are not whole days, written as timestamps
 
     def __init__(self, attribute: dict[str, Any]):
         self._data = None
+        self._seed = 0
+        self._scale_domain = None
+        self._expression_text = None
+        self._expression = None
+        self._explicit_length = "length" in attribute
+        self._distribution_spec = None
+        self._distribution = None
+        self._null_fraction = 0.0
+        self._dictionary = None
+        self._time_of_day = False
+        if "scale_domain" in attribute:
+            self._scale_domain = str(attribute["scale_domain"]).lower() in ("true", "1")
         self._name = attribute["name"]
+        if "null_fraction" in attribute:
+            try:
+                self._null_fraction = float(attribute["null_fraction"])
+            except (TypeError, ValueError):
+                raise InvalidAttribute(f"attribute '{self._name}' has a null_fraction which is not a number")
+            if not 0 <= self._null_fraction <= 1:
+                raise InvalidAttribute(f"attribute '{self._name}' has a null_fraction outside of [0, 1]")
         att_type = attribute["type"].upper()
         if att_type == "FOREIGN_KEY":
             if "references" not in attribute:
@@ -143,6 +244,24 @@ class DbAttribute:
             self._type = map_str_to_type[att_type]
         if self._references:
             return
+        if attribute.get("generation", "RANDOM").upper() == "EXPRESSION":
+            if "expression" not in attribute:
+                raise InvalidAttribute(f"attribute '{self._name}' is generated by an expression but no 'expression' is given")
+            self._expression_text = str(attribute["expression"])
+            self._generation = GenerationMode.EXPRESSION
+            self._start = None
+            self._step = None
+            self._length = int(attribute["length"]) if self._explicit_length else None
+            return
+        if attribute.get("generation", "RANDOM").upper() == "ENUM":
+            if "distribution" in attribute:
+                raise InvalidAttribute(f"attribute '{self._name}' has a distribution but only random integers and reals can have one")
+            self._generation = GenerationMode.ENUM
+            self._start = None
+            self._step = None
+            self._length = int(attribute["length"]) if self._explicit_length else None
+            self._build_dictionary(attribute)
+            return
         if self._type != DbType.STRING:
             self._start = map_starting_to_cast[self._type](attribute.get("start", "0"))
             self._step = map_step_to_cast[self._type](
@@ -160,36 +279,158 @@ class DbAttribute:
         self._generation = map_str_to_generation_type[
             attribute.get("generation", "RANDOM").upper()
         ]
+        if "distribution" in attribute:
+            if self._type not in (DbType.INTEGER, DbType.REAL) or self._generation != GenerationMode.RANDOM:
+                raise InvalidAttribute(f"attribute '{self._name}' has a distribution but only random integers and reals can have one")
+            self._distribution_spec = attribute["distribution"]
+            self._build_distribution()
+
+    def _build_dictionary(self, attribute: dict[str, Any]):
+        cast = str if self._type == DbType.STRING else map_starting_to_cast[self._type]
+        try:
+            self._dictionary = parse_dictionary(attribute.get("values"), attribute.get("values_file"), attribute.get("weights"), cast)
+        except InvalidDictionary as e:
+            raise InvalidAttribute(f"attribute '{self._name}' has invalid enum values: {e}")
+        if self._type == DbType.STRING:
+            longest = max(map(len, self._dictionary.values))
+            if not self._explicit_length:
+                self._length = longest
+            elif longest > self._length:  # type: ignore
+                raise InvalidAttribute(f"attribute '{self._name}' has an enum value longer than its length {self._length}")
+
+    def _build_distribution(self):
+        try:
+            self._distribution = parse_distribution(self._distribution_spec, self._type == DbType.INTEGER, self._step)
+        except InvalidDistribution as e:
+            raise InvalidAttribute(f"attribute '{self._name}' has an invalid distribution: {e}")
 
     @property
     def type(self):
         if self._references and isinstance(self._references.attribute, DbAttribute):
-            return self._references.attribute._type
+            return self._references.attribute.type
         return self._type
 
     @property
     def length(self):
         if self._references and isinstance(self._references.attribute, DbAttribute):
-            return self._references.attribute._length
+            return self._references.attribute.length
         return self._length
 
     @property
     def data(self):
         return self._data
-    
-    def _update_length_if_needed(self):
-        GENMOD_TO_ADJUST = [GenerationMode.NATURALTEXT, GenerationMode.NAMESURNAME, GenerationMode.EMAIL, GenerationMode.PHONE]
-        if self._data is None:
-            raise ValueError("Attribute data is None, cannot update length")
-        if not hasattr(self, "_generation"):
+
+    @property
+    def sql_length(self):
+        # computed from the generator bounds rather than from the data so that the DDL
+        # is the same no matter which rows (or which shard of them) were generated
+        if self._references and isinstance(self._references.attribute, DbAttribute):
+            return self._references.attribute.sql_length
+        if self._type != DbType.STRING:
+            return None
+        if self._generation == GenerationMode.EXPRESSION:
+            # an explicit length wins over the longest string the expression can build
+            if self._length is not None:
+                return self._length
+            return self._expression.max_length if self._expression else 10
+        return GenerateString.max_length(self._generation, self._length)  # type: ignore
+
+    def _pattern(self):
+        return self._step if self.type != DbType.STRING else self._length
+
+    def scale_domain(self, scale: float, is_key: bool):
+        # widens the value domain of random and repeating numbers along with the row count,
+        # so that key density (and with it uniqueness) stays the same at every scale
+        if self._references or not (self._scale_domain if self._scale_domain is not None else is_key):
             return
-        if self.type == DbType.STRING and self._generation in GENMOD_TO_ADJUST:
-            self._length = max(map(len, self._data))
-        else:
+        if self._type not in (DbType.INTEGER, DbType.REAL):
             return
+        if self._generation not in (GenerationMode.RANDOM, GenerationMode.REPEATING):
+            return
+        if self._type == DbType.INTEGER:
+            self._step = max(1, round(self._step * scale))
+        else:
+            self._step = self._step * scale
+        if self._distribution_spec is not None:
+            # parameters defaulting to the step follow it
+            self._build_distribution()
+
+    def _chunks(self, lo: int, hi: int):
+        for chunk in range(lo // CHUNK_ROWS, (hi + CHUNK_ROWS - 1) // CHUNK_ROWS):
+            chunk_start = chunk * CHUNK_ROWS
+            yield chunk, chunk_start, max(lo, chunk_start), min(hi, chunk_start + CHUNK_ROWS)
+
+    def generate_range(self, lo: int, hi: int) -> list[Any]:
+        values = []
+        pattern = self._pattern()
+        for chunk, chunk_start, chunk_lo, chunk_hi in self._chunks(lo, hi):
+            rng = random.Random(derive_seed(self._seed, chunk))
+            if self._dictionary is not None:
+                # codes of the whole chunk, the column keeps them instead of the values
+                values.extend(self._dictionary.codes(rng, chunk_hi - chunk_start)[chunk_lo - chunk_start:])
+                continue
+            if self._distribution is not None:
+                # the whole chunk is drawn at once, so any row range gets the same values
+                values.extend(self._distribution.sample(rng, chunk_hi - chunk_start)[chunk_lo - chunk_start:])
+                continue
+            gen = value_generator_factory(
+                self.type,
+                chunk_hi,
+                self._generation,
+                self._start,
+                rng=rng,
+                seed=self._seed,
+            )
+            gen.seek(chunk_start, pattern)
+            chunk_values = list(gen.generate(pattern))
+            values.extend(chunk_values[chunk_lo - chunk_start:])
+        if self._dictionary is not None:
+            return EncodedColumn(self._dictionary, values)
+        return values
+
+    def sample_range(self, lo: int, hi: int, keys: list[Any] | KeyColumn) -> list[Any]:
+        # foreign keys pick a random row of the referenced column
+        if len(keys) == 0:
+            raise ValueError(f"Attribute {self._name} references an attribute with no rows")
+        values = []
+        for chunk, chunk_start, chunk_lo, chunk_hi in self._chunks(lo, hi):
+            rng = random.Random(derive_seed(self._seed, chunk))
+            indexes = [rng.randrange(len(keys)) for _ in range(chunk_start, chunk_hi)]
+            values.extend(keys[i] for i in indexes[chunk_lo - chunk_start:])
+        return values
+
+    def validity(self, lo: int, hi: int) -> bytearray | None:
+        # bit i - lo is set when row i has a value, None when the attribute is never NULL.
+        # Drawn per chunk from its own rng, so it doesn't change the values themselves
+        if self._null_fraction == 0:
+            return None
+        bitmap = bytearray((hi - lo + 7) // 8)
+        fraction = self._null_fraction
+        for chunk, chunk_start, chunk_lo, chunk_hi in self._chunks(lo, hi):
+            rng = random.Random(derive_seed(self._seed, "null", chunk))
+            draws = [rng.random() for _ in range(chunk_hi - chunk_start)]
+            for i in range(chunk_lo, chunk_hi):
+                if draws[i - chunk_start] >= fraction:
+                    bitmap[(i - lo) >> 3] |= 1 << ((i - lo) & 7)
+        return bitmap
+
+    def apply_validity(self, values: list[Any], lo: int, hi: int) -> list[Any]:
+        # rows without a value become None, which every writer outputs as NULL (an empty field in csv)
+        bitmap = self.validity(lo, hi)
+        if bitmap is None:
+            return values
+        if isinstance(values, EncodedColumn):
+            null = values.dictionary.null_code
+            return EncodedColumn(values.dictionary, [code if bitmap[i >> 3] >> (i & 7) & 1 else null for i, code in enumerate(values.codes)])
+        return [value if bitmap[i >> 3] >> (i & 7) & 1 else None for i, value in enumerate(values)]
+
+    @property
+    def nullable(self) -> bool:
+        return self._null_fraction > 0
 
     def sql_string(self, dialect: SQLDialect) -> str:
-        return f"{self._name} {make_sql_type_from_type(self.type, self.length if self.length else 0, dialect)} NOT NULL"
+        not_null = "" if self.nullable else " NOT NULL"
+        return f"{self._name} {make_sql_type_from_type(self.type, self.sql_length if self.sql_length else 0, dialect, self._time_of_day)}{not_null}"
 
 
 class ForeignKey:
@@ -206,12 +447,48 @@ class DbTable:
     _attributes: dict[str, DbAttribute]
     _quantity: int
     _keys: list[DbAttribute]
+    _seed: int
+    _base_quantity: int
+    _scaling: ScalingMode
+    _scaling_table: str | None
+    _scaling_ratio: float | None
+    _referenced: list[DbAttribute]  # attributes referenced by foreign keys
+    _key_store: KeyStore | None  # None keeps referenced columns in memory
+    _key_writers: dict[str, KeyColumnWriter]
+    _generation_order: list[DbAttribute]  # expressions come after the attributes they use
+    _row_cache: RowCache | None  # batches kept between the requests of a worker
+    _selected: bool  # written to the output, unselected tables only provide sampled keys
+    _time_series: TimeSeriesSpec | None  # events of the entities of a parent table, in time order
+    _event_stream: EventStream | None
+    _events: tuple[int, int, list[int], list[datetime]] | None  # rows of the last batch of events
 
     def __init__(self, table: dict[str, Any]):
         self._name = table["name"]
         self._quantity = int(table["rows"])
+        self._base_quantity = self._quantity
         self._attributes = {}
         self._keys = []
+        self._seed = 0
+        self._referenced = []
+        self._key_store = None
+        self._key_writers = {}
+        self._generation_order = []
+        self._row_cache = None
+        self._selected = str(table.get("generate", True)).lower() in ("true", "1")
+        self._time_series = None
+        self._event_stream = None
+        self._events = None
+        scaling = table.get("scaling", {"mode": "linear"})
+        if isinstance(scaling, str):
+            scaling = {"mode": scaling}
+        try:
+            self._scaling = map_str_to_scaling_mode[scaling.get("mode", "linear").upper()]
+        except KeyError:
+            raise InvalidTable(f"table '{self._name}' has invalid scaling mode '{scaling.get('mode')}'")
+        self._scaling_table = scaling.get("table")
+        self._scaling_ratio = float(scaling["ratio"]) if "ratio" in scaling else None
+        if self._scaling == ScalingMode.PROPORTIONAL and self._scaling_table is None:
+            raise InvalidTable(f"table '{self._name}' scales proportionally but no 'table' is given in its scaling")
         if "attributes" not in table:
             raise InvalidTable(f"table '{self._name}' must have an 'attribute' array")
         for attribute in table["attributes"]:
@@ -232,6 +509,56 @@ class DbTable:
         if "primary_keys" in table:
             for key in table["primary_keys"]:
                 self._keys.append(self._attributes[key])
+                if self._attributes[key].nullable:
+                    raise InvalidTable(f"table '{self._name}' is invalid because primary key '{key}' has a null_fraction")
+        if "time_series" in table:
+            self._parse_time_series(table["time_series"])
+        self._generation_order = list(self._attributes.values())
+
+    def _parse_time_series(self, spec: Any):
+        try:
+            self._time_series = parse_time_series(spec)
+        except InvalidTimeSeries as e:
+            raise InvalidTable(f"table '{self._name}' is invalid => {e}")
+        entity = self._attributes.get(self._time_series.entity)
+        timestamp = self._attributes.get(self._time_series.timestamp)
+        if entity is None or entity._references is None:
+            raise InvalidTable(f"table '{self._name}' is invalid => time series entity '{self._time_series.entity}' must be a foreign key of the table")
+        if timestamp is None or timestamp._references is not None or timestamp._type != DbType.DATE:
+            raise InvalidTable(f"table '{self._name}' is invalid => time series timestamp '{self._time_series.timestamp}' must be a date attribute of the table")
+        if timestamp._expression_text is not None or timestamp._dictionary is not None:
+            raise InvalidTable(f"table '{self._name}' is invalid => time series timestamp '{timestamp._name}' takes its start and step, it cannot be an expression or an enum")
+        if entity.nullable or timestamp.nullable:
+            raise InvalidTable(f"table '{self._name}' is invalid => the entity and timestamp of a time series cannot have a null_fraction")
+        if timestamp._step <= timedelta(0):
+            raise InvalidTable(f"table '{self._name}' is invalid => time series timestamp '{timestamp._name}' must have a positive step")
+        timestamp._time_of_day = True
+
+    def compile_expressions(self):
+        # needs the types of foreign keys, so it runs once references are resolved
+        columns = {
+            name: (attribute.type, attribute.sql_length)
+            for name, attribute in self._attributes.items()
+            if attribute._expression_text is None
+        }
+        ordered: list[DbAttribute] = [attribute for attribute in self._attributes.values() if attribute._name in columns]
+        pending = [attribute for attribute in self._attributes.values() if attribute._name not in columns]
+        try:
+            uses = {attribute._name: CompiledExpression.referenced_names(attribute._expression_text) for attribute in pending}  # type: ignore
+            while pending:
+                ready = [attribute for attribute in pending if not uses[attribute._name] & uses.keys() - columns.keys()]
+                if not ready:
+                    raise InvalidTable(f"table '{self._name}' has cyclic expressions: {', '.join(a._name for a in pending)}")
+                for attribute in ready:
+                    attribute._expression = CompiledExpression(attribute._expression_text, attribute._type, columns)  # type: ignore
+                    if nullable := [name for name in sorted(attribute._expression.dependencies) if self._attributes[name].nullable]:
+                        raise InvalidTable(f"table '{self._name}' is invalid => expression of '{attribute._name}' uses '{nullable[0]}' which has a null_fraction")
+                    columns[attribute._name] = (attribute._type, attribute.sql_length)
+                    ordered.append(attribute)
+                    pending.remove(attribute)
+        except InvalidExpression as exc:
+            raise InvalidTable(f"table '{self._name}' is invalid => {exc}")
+        self._generation_order = ordered
 
     def _get_foreign_attribute(self, attribute: DbAttribute) -> DbAttribute | None:
         if attribute._references and isinstance(
@@ -242,119 +569,276 @@ class DbTable:
 
     def __hash__(self):
         return hash(self._name)
+
+    def scale(self, scale_factor: float, tables: dict[str, DbTable], scaled: set[str], visiting: set[str]):
+        if self._name in scaled:
+            return
+        if self._name in visiting:
+            raise InvalidTable(f"table '{self._name}' has a cyclic proportional scaling")
+        visiting.add(self._name)
+        match self._scaling:
+            case ScalingMode.LINEAR:
+                self._quantity = round(self._base_quantity * scale_factor)
+                if self._base_quantity > 0 and scale_factor > 0:
+                    self._quantity = max(1, self._quantity)
+            case ScalingMode.FIXED:
+                self._quantity = self._base_quantity
+            case ScalingMode.PROPORTIONAL:
+                if self._scaling_table not in tables:
+                    raise InvalidTable(f"table '{self._name}' scales proportionally to unknown table '{self._scaling_table}'")
+                parent = tables[self._scaling_table]  # type: ignore
+                parent.scale(scale_factor, tables, scaled, visiting)
+                ratio = self._scaling_ratio
+                if ratio is None:
+                    ratio = self._base_quantity / parent._base_quantity if parent._base_quantity else 0.0
+                self._quantity = round(parent._quantity * ratio)
+        visiting.remove(self._name)
+        scaled.add(self._name)
+        if self._base_quantity > 0 and self._quantity != self._base_quantity:
+            for attribute in self._attributes.values():
+                attribute.scale_domain(self._quantity / self._base_quantity, attribute in self._keys)
+
+    def assign_seed(self, schema_seed: int):
+        self._seed = derive_seed(schema_seed, self._name)
+        for attribute in self._attributes.values():
+            attribute._seed = derive_seed(self._seed, attribute._name)
     
-    def _generate_oracle_sql(self, f: TextIOWrapper):
+    def _generate_oracle_sql(self, f: TextIOWrapper, primary_key: bool):
         sql = f"CREATE TABLE {self._name} (\n"
         for attribute in self._attributes.values():
             sql += f"\t{attribute.sql_string(SQLDialect.ORACLE)}, \n"
-        if len(self._keys) > 0:
+        if len(self._keys) > 0 and primary_key:
             sql += f'\tCONSTRAINT pk_{self._name} PRIMARY KEY ({", ".join(map(lambda x: x._name, self._keys))})\n);\n'
         else:
             sql = sql[:-3] + "\n);\n"
         f.write(sql) # type: ignore
 
-    def _generate_postgres_sql(self, f: TextIOWrapper):
+    def _generate_postgres_sql(self, f: TextIOWrapper, primary_key: bool):
         sql = f"CREATE TABLE {self._name} (\n"
         for attribute in self._attributes.values():
             sql += f"\t{attribute.sql_string(SQLDialect.POSTGRES)}, \n"
-        if len(self._keys) > 0:
+        if len(self._keys) > 0 and primary_key:
             sql += f'\tCONSTRAINT pk_{self._name} PRIMARY KEY ({", ".join(map(lambda x: x._name, self._keys))})\n);\n'
         else:
             sql = sql[:-3] + "\n);\n"
         f.write(sql) # type: ignore
 
-    def generate_sql(self, f: TextIOWrapper, dialect: SQLDialect):
+    def generate_sql(self, f: TextIOWrapper, dialect: SQLDialect, primary_key: bool = True):
         if dialect == SQLDialect.POSTGRES:
-            self._generate_postgres_sql(f)
+            self._generate_postgres_sql(f, primary_key)
         elif dialect == SQLDialect.ORACLE:
-            self._generate_oracle_sql(f)
+            self._generate_oracle_sql(f, primary_key)
         else:
             raise ValueError(f"Invalid dialect {dialect}")
 
-    def generate_insertion_sql(self, f: TextIOWrapper, dialect: SQLDialect):
-        for i in range(self._quantity):
-            sql = f'INSERT INTO {self._name}({", ".join(self._attributes)}) VALUES ('
-            for attribute in self._attributes.values():
-                if not attribute.data:
-                    raise ValueError(f"Attribute {attribute._name} has no data")
-                if attribute.type == DbType.STRING:
-                    attribute_str = f"'{attribute.data[i]}'"
-                elif attribute.type == DbType.DATE:
-                    if dialect == SQLDialect.POSTGRES:
-                        attribute_str = f"'{attribute.data[i]}'"
-                    elif dialect == SQLDialect.ORACLE:
-                        attribute_str = (
-                            f"TO_TIMESTAMP('{attribute.data[i]}', 'YYYY-MM-DD HH24:MI:SS')"
-                        )
-                    else:
-                        raise ValueError(f"Invalid dialect {dialect}")
-                else:
-                    attribute_str = str(attribute.data[i])
-                sql += f"{attribute_str}, "
-            sql = sql[:-2] + ");\n"
-            f.write(sql)
-
-    def _generate_single_attr_data(self, attribute: DbAttribute):
-        if fk_attr := self._get_foreign_attribute(attribute):
-            if fk_attr.data:
-                return fk_attr.data
-            gen = value_generator_factory(
-                fk_attr.type,
-                self._quantity,
-                attribute._generation,
-                attribute._start,
-            ).generate(
-                attribute._step
-                if attribute.type != DbType.STRING
-                else attribute._length
-            )
-            return list(gen)
+    def primary_key_sql(self) -> str:
+        # same for both dialects
+        return f'ALTER TABLE {self._name} ADD CONSTRAINT pk_{self._name} PRIMARY KEY ({", ".join(map(lambda x: x._name, self._keys))});\n'
+
+    def write_insertion_sql(self, f: TextIOWrapper, columns: dict[str, list[Any]], count: int, dialect: SQLDialect):
+        # the rows are handed over one by one, part files are only cut between them
+        with PROFILER.stage("format_sql", self._name) as scope:
+            rows = RowLines()
+            self._format_insertion_sql(rows, columns, count, dialect)  # type: ignore
+            scope.add(rows=count)
+        with PROFILER.stage("write_sql", self._name) as scope:
+            scope.add(rows=count, bytes=f.write_rows(rows))  # type: ignore
+
+    def _format_insertion_sql(self, f: io.StringIO, columns: dict[str, list[Any]], count: int, dialect: SQLDialect):
+        # formatted a column at a time, enum columns only look up their formatted values
+        if count == 0:
+            return
+        cells = []
+        for name, attribute in self._attributes.items():
+            column = columns[name]
+            format = lambda value, type=attribute.type: sql_literal(type, value, dialect)
+            cells.append(column.cells(("sql", attribute.type, dialect), format) if isinstance(column, EncodedColumn) else list(map(format, column)))
+        prefix = f'INSERT INTO {self._name}({", ".join(self._attributes)}) VALUES ('
+        for row in zip(*cells):
+            f.write(prefix + ", ".join(row) + ");\n")
+
+    def generate_column(self, attribute: DbAttribute, lo: int, hi: int, columns: dict[str, list[Any]] | None = None) -> list[Any]:
+        # columns holds already generated columns of the same rows, which expressions can reuse
+        if self._time_series is not None and attribute._name in (self._time_series.entity, self._time_series.timestamp):
+            values = self._time_series_column(attribute, lo, hi)
+        elif fk_attr := self._get_foreign_attribute(attribute):
+            values = attribute.sample_range(lo, hi, attribute._references.table.key_column(fk_attr))  # type: ignore
+        elif attribute._expression is not None:
+            inputs = {
+                name: columns[name] if columns is not None and name in columns else self.generate_column(self._attributes[name], lo, hi, columns)
+                for name in attribute._expression.dependencies
+            }
+            values = attribute._expression.evaluate(inputs, lo, hi, attribute._seed, CHUNK_ROWS)
         else:
-            gen = value_generator_factory(
-                attribute.type,
-                self._quantity,
-                attribute._generation,
-                attribute._start,
-            ).generate(
-                attribute._step
-                if attribute.type != DbType.STRING
-                else attribute._length
-            )
-            return list(gen)
+            values = attribute.generate_range(lo, hi)
+        return attribute.apply_validity(values, lo, hi)
 
-    def write_to_csv(self, directory):
-        filename = f"{self._name}.csv"
-        with open(os.path.join(directory, filename), "w", newline="") as file:
-            writer = DictWriter(
-                file, fieldnames=[attribute for attribute in self._attributes]
-            )
-            writer.writeheader()
-            for i in range(self._quantity):
-                row = {}
-                for name, attr in self._attributes.items():
-                    if attr.data is None:
-                        raise ValueError("Attribute data is None")
-                    if attr._references:
-                        # if attribute is foreign key, then it's data is the same as
-                        # the data of the attribute it references
-                        # we index at random to add some variance to the data
-                        row[name] = attr.data[random.randint(0, self._quantity - 1)]
-                    else:
-                        row[name] = attr.data[i]
-                writer.writerow(row)
+    def _time_series_column(self, attribute: DbAttribute, lo: int, hi: int) -> list[Any]:
+        # entity and timestamp come from the same events, which are merged once for both
+        spec: TimeSeriesSpec = self._time_series  # type: ignore
+        entity = self._attributes[spec.entity]
+        fk_attr: DbAttribute = self._get_foreign_attribute(entity)  # type: ignore
+        keys = entity._references.table.key_column(fk_attr)  # type: ignore
+        if self._events is None or self._events[:2] != (lo, hi):
+            if self._event_stream is None or self._event_stream.entities != len(keys):
+                timestamp = self._attributes[spec.timestamp]
+                if len(keys) == 0:
+                    raise ValueError(f"Time series of table {self._name} has no entities, {fk_attr._name} has no rows")
+                self._event_stream = EventStream(len(keys), timestamp._start, timestamp._step, spec.jitter, derive_seed(self._seed, "time_series"))
+            with PROFILER.stage("merge_events", self._name) as scope:
+                self._events = (lo, hi, *self._event_stream.events(lo, hi))
+                scope.add(rows=hi - lo)
+        if attribute._name == spec.entity:
+            return keys.take(self._events[2]) if isinstance(keys, KeyColumn) else list(map(keys.__getitem__, self._events[2]))
+        return self._events[3]
 
-    def generate_data(self, directory: str):
-        for attribute in self._attributes.values():
-            attribute._data = self._generate_single_attr_data(attribute)
-            attribute._update_length_if_needed()
+    def unique_values(self, attribute: DbAttribute) -> bool:
+        # increasing and decreasing numbers and dates never repeat a value (time series timestamps come from the events)
+        if attribute._references or attribute._type == DbType.STRING or not attribute._step:
+            return False
+        if self._time_series is not None and attribute._name == self._time_series.timestamp:
+            return False
+        return attribute._generation in (GenerationMode.INCREASING, GenerationMode.DECREASING)
+
+    def key_column(self, attribute: DbAttribute) -> list[Any] | KeyColumn:
+        # the whole column of an attribute referenced by a foreign key,
+        # it is materialised (and kept) even when only a slice of this table is generated.
+        # With a key store it is spilled to a memory mapped file one batch at a time
+        if attribute._data is None:
+            with PROFILER.stage("generate_keys", self._name, attribute._name) as scope:
+                if self._key_store is None:
+                    attribute._data = self.generate_column(attribute, 0, self._quantity)
+                else:
+                    if partial := self._key_writers.pop(attribute._name, None):
+                        self._key_store.discard(partial)
+                    writer = self._key_store.writer(self._name, attribute._name, attribute.type)
+                    batch_rows = DEFAULT_BATCH_CHUNKS * CHUNK_ROWS
+                    for lo in range(0, self._quantity, batch_rows):
+                        writer.append(self.generate_column(attribute, lo, min(lo + batch_rows, self._quantity)))
+                    attribute._data = self._key_store.finish(writer)
+                scope.add(rows=self._quantity)
+        return attribute._data
+
+    def _spill_keys(self, columns: dict[str, list[Any]], lo: int, hi: int):
+        # referenced columns are spilled while this table is generated from its first row,
+        # so that its dependents (which come later in the schema) don't generate them again
+        if self._key_store is None:
+            return
+        for attribute in self._referenced:
+            if attribute._data is not None:
+                continue
+            writer = self._key_writers.get(attribute._name)
+            if writer is None:
+                if lo != 0:
+                    continue
+                writer = self._key_writers[attribute._name] = self._key_store.writer(self._name, attribute._name, attribute.type)
+            elif writer.rows != lo:
+                # rows were skipped (resumed or sharded run), key_column regenerates the whole column
+                continue
+            with PROFILER.stage("spill_keys", self._name, attribute._name) as scope:
+                writer.append(columns[attribute._name])
+                scope.add(rows=hi - lo)
+            if writer.rows == self._quantity:
+                del self._key_writers[attribute._name]
+                attribute._data = self._key_store.finish(writer)
+
+    def generate_rows(self, lo: int, hi: int, spill: bool = True) -> dict[str, list[Any]]:
+        if self._row_cache is not None and (cached := self._row_cache.get(self._name, lo, hi)) is not None:
+            PROFILER.count("row_cache_hit", rows=hi - lo, table=self._name)
+            if spill:
+                self._spill_keys(cached, lo, hi)
+            return cached
+        columns = {}
+        for attribute in self._generation_order:
+            with PROFILER.stage("generate", self._name, attribute._name) as scope:
+                columns[attribute._name] = self.generate_column(attribute, lo, hi, columns)
+                scope.add(rows=hi - lo)
+        if spill:
+            self._spill_keys(columns, lo, hi)
+        columns = {name: columns[name] for name in self._attributes}
+        if self._row_cache is not None:
+            self._row_cache.put(self._name, lo, hi, columns)
+        return columns
+
+    def write_csv_rows(self, f: TextIOWrapper, columns: dict[str, list[Any]], count: int, header: bool):
+        # the rows are handed over one by one, part files are only cut between them
+        with PROFILER.stage("format_csv", self._name) as scope:
+            rows = RowLines()
+            self._format_csv_rows(rows, columns, count, header)  # type: ignore
+            scope.add(rows=count)
+        with PROFILER.stage("write_csv", self._name) as scope:
+            scope.add(rows=count, bytes=f.write_rows(rows))  # type: ignore
+
+    def _format_csv_rows(self, f: io.StringIO, columns: dict[str, list[Any]], count: int, header: bool):
+        # same output as the csv module, every row written with a single write, which part files
+        # and the sorted output rely on
+        if header:
+            f.write(",".join(map(_csv_cell, self._attributes)) + "\r\n")
+        if count == 0:
+            return
+        cells = [self._csv_cells(attribute, columns[name]) for name, attribute in self._attributes.items()]
+        if len(cells) == 1:
+            # an empty row would be a blank line, the csv module quotes its only field instead
+            cells = [[cell or '""' for cell in cells[0]]]
+        for row in zip(*cells):
+            f.write(",".join(row) + "\r\n")
+
+    @staticmethod
+    def _csv_cells(attribute: DbAttribute, column: list[Any]) -> list[str]:
+        # escaped a column at a time, enum columns only look up the text of their values
+        if isinstance(column, EncodedColumn):
+            return column.cells("csv", _csv_cell)
+        if attribute.type != DbType.STRING and None not in column:
+            # numbers and dates never need quotes
+            return list(map(str, column))
+        return list(map(_csv_cell, column))
+
+
+class _Output:
+    # one output format of a run, csv (dialect None) or sql, with its checkpoint and, when all the
+    # tables go in a single file, that file
+    dialect: SQLDialect | None
+    checkpoint: Checkpoint | None
+    file: ResumableFile | None
+
+    def __init__(self, dialect: SQLDialect | None, checkpoint: Checkpoint | None):
+        self.dialect = dialect
+        self.checkpoint = checkpoint
+        self.file = None
 
 
 class DbSchema:
     _tables: list[DbTable]
     _name: str
+    _seed: int
+    _digest: str
+    _batch_rows: int
+    _checkpoints: bool
+    _scale_factor: float
+    _key_store: KeyStore
+    _source: dict[str, Any]
+    _sort_by_primary_key: bool
+    _sort_workers: int
+    _write_buffers: int
+    _partitioning: PartitionSpec | None
+    _statistics: bool  # column statistics of every table are written next to its output (off by default)
 
-    def __init__(self, name: str, schema: dict[str, Any]):
+    def __init__(self, name: str, schema: dict[str, Any], seed: int | None = None, digest: str = "", scale_factor: float | None = None, sort_by_primary_key: bool | None = None):
         self._name = name
+        self._source = schema
+        self._scale_factor = scale_factor if scale_factor is not None else float(schema.get("scale_factor", 1))
+        if sort_by_primary_key is None:
+            sort_by_primary_key = str(schema.get("sort_by_primary_key", False)).lower() in ("true", "1")
+        self._sort_by_primary_key = sort_by_primary_key
+        self._sort_workers = os.cpu_count() or 1
+        self._write_buffers = DEFAULT_WRITE_BUFFERS
+        self._partitioning = None
+        self._statistics = False
+        self._seed = seed if seed is not None else random.SystemRandom().getrandbits(63)
+        self._digest = digest
+        self._file_digest = digest
+        self._batch_rows = DEFAULT_BATCH_CHUNKS * CHUNK_ROWS
+        self._checkpoints = False
         self._tables = []
         for table in schema["tables"]:
             try:
@@ -365,21 +849,327 @@ class DbSchema:
                 )
             except InvalidTable as e:
                 raise InvalidSchema(f"Schema is invalid", e)
+        with PROFILER.stage("fk_resolution"):
+            for table in self._tables:
+                for attr in filter(lambda x: x._references, table._attributes.values()):
+                    referenced_table = next(filter(lambda x: x._name == attr._references.table, self._tables))  # type: ignore
+                    referenced_attribute = referenced_table._attributes[attr._references.attribute]  # type: ignore
+                    attr._references.assign_actual_reference(referenced_table, referenced_attribute)  # type: ignore
+                    if referenced_attribute not in referenced_table._referenced:
+                        referenced_table._referenced.append(referenced_attribute)
+                    if referenced_attribute.nullable:
+                        raise InvalidSchema(f"Schema is invalid => '{table._name}.{attr._name}' references '{referenced_table._name}.{referenced_attribute._name}' which has a null_fraction")
+            self._order_tables()
+        try:
+            # parents first, so that the lengths of referenced string expressions are known
+            for table in self._tables:
+                table.compile_expressions()
+        except InvalidTable as e:
+            raise InvalidSchema(f"Schema is invalid", e)
+        self._file_selection = {table._name for table in self._tables if table._selected}
+        self._key_store = KeyStore(name)
+        self._key_store.shared = self._shares_key_columns()
         for table in self._tables:
-            for attr in filter(lambda x: x._references, table._attributes.values()):
-                referenced_table = next(filter(lambda x: x._name == attr._references.table, self._tables))  # type: ignore
-                referenced_attribute = referenced_table._attributes[attr._references.attribute]  # type: ignore
-                attr._references.assign_actual_reference(referenced_table, referenced_attribute)  # type: ignore
-        self._generate_data()
+            table.assign_seed(self._seed)
+            table._key_store = self._key_store
+        if self._scale_factor < 0:
+            raise InvalidSchema(f"Schema is invalid => scale factor {self._scale_factor} is negative")
+        tables_by_name = {table._name: table for table in self._tables}
+        scaled: set[str] = set()
+        try:
+            for table in self._tables:
+                table.scale(self._scale_factor, tables_by_name, scaled, set())
+        except InvalidTable as e:
+            raise InvalidSchema(f"Schema is invalid", e)
+
+    def _order_tables(self):
+        # parents come before the tables referencing them, so that their key columns are spilled
+        # while they are generated and rows can be loaded in file order with the constraints enabled.
+        # Ties (and tables in a reference cycle) keep the order of the schema file
+        parents = {
+            table._name: {
+                attr._references.table._name  # type: ignore
+                for attr in table._attributes.values()
+                if attr._references and attr._references.table is not table
+            }
+            for table in self._tables
+        }
+        ordered: list[DbTable] = []
+        placed: set[str] = set()
+        remaining = list(self._tables)
+        while remaining:
+            ready = [table for table in remaining if parents[table._name] <= placed]
+            if not ready:
+                ready = remaining[:1]
+            for table in ready:
+                ordered.append(table)
+                placed.add(table._name)
+                remaining.remove(table)
+        self._tables = ordered
 
-    def _generate_data(self):
+    def close(self):
+        # removes the spilled key columns
+        self._key_store.close()
+
+    def select_tables(self, names: list[str] | None):
+        # only the selected tables are written, the key columns their foreign keys sample
+        # are still generated from the (unselected) parents, but nothing else of them
+        # and None restores the selection of the schema file
+        if names is None:
+            for table in self._tables:
+                table._selected = table._name in self._file_selection
+            self._digest = self._file_digest
+            return
+        known = {table._name for table in self._tables}
+        if unknown := [name for name in names if name not in known]:
+            raise InvalidSchema(f"Schema {self._name} has no table(s) {', '.join(unknown)}")
         for table in self._tables:
-            table.generate_data(self._name)
+            table._selected = table._name in names
+        self._digest = hashlib.sha256(f"{self._file_digest}\0tables={','.join(sorted(set(names)))}".encode("utf-8")).hexdigest()
 
-    def generate_csv(self):
-        os.makedirs(self._name, exist_ok=True)
+    @property
+    def selected_tables(self) -> list[DbTable]:
+        return [table for table in self._tables if table._selected]
+
+    def key_source_tables(self) -> list[DbTable]:
+        # unselected tables whose key columns the selected ones sample, following foreign keys to foreign keys
+        needed: set[DbAttribute] = set()
+        pending = [attribute for table in self.selected_tables for attribute in table._attributes.values()]
+        while pending:
+            attribute = pending.pop()
+            if attribute._references and attribute._references.attribute not in needed:  # type: ignore
+                needed.add(attribute._references.attribute)  # type: ignore
+                pending.append(attribute._references.attribute)  # type: ignore
+        return [table for table in self._tables if not table._selected and any(attribute in needed for attribute in table._attributes.values())]
+
+    def configure_row_cache(self, cache: RowCache | None):
         for table in self._tables:
-            table.write_to_csv(self._name)
+            table._row_cache = cache
+
+    @property
+    def seed(self):
+        return self._seed
+
+    @property
+    def digest(self):
+        return self._digest
+
+    @property
+    def scale_factor(self):
+        return self._scale_factor
+
+    @property
+    def sort_by_primary_key(self):
+        return self._sort_by_primary_key
+
+    def configure_sorting(self, workers: int | None):
+        self._sort_workers = max(1, workers) if workers else os.cpu_count() or 1
+        self._key_store.shared = self._shares_key_columns()
+
+    def _shares_key_columns(self) -> bool:
+        # sort workers map the referenced key columns from their files, which must not be unlinked
+        return self._sort_by_primary_key and self._sort_workers > 1
+
+    def configure_writes(self, buffers: int):
+        # batches queued per output file for its writer thread, 0 writes them synchronously
+        self._write_buffers = max(0, buffers)
+
+    def configure_partitioning(self, spec: PartitionSpec | None):
+        # with a spec every table is written as part files, with a script loading them in parallel
+        self._partitioning = spec
+
+    def configure_statistics(self, enabled: bool):
+        self._statistics = enabled
+
+    def _table_statistics(self, table: DbTable, checkpoint: Checkpoint | None, rows_done: int) -> TableStatistics | None:
+        # a resumed table continues the statistics saved in the checkpoint with its rows done, when the
+        # interrupted run gathered none there are no statistics for the table
+        if not self._statistics:
+            return None
+        if rows_done == 0:
+            return TableStatistics.of(table)
+        state = checkpoint.statistics(table._name) if checkpoint else None
+        return TableStatistics.from_state(state) if state is not None else None
+
+    def _write_statistics(self, table: DbTable, statistics: TableStatistics | None):
+        # <schema>/<table>.stats.json, next to the csv file or the parts of the table (and to <schema>.sql)
+        if statistics is None:
+            return
+        os.makedirs(self._name, exist_ok=True)
+        statistics.write(statistics_path(self._name, table._name))
+
+    def _sorted(self, table: DbTable) -> bool:
+        # tables without primary keys are written in generation order
+        return self._sort_by_primary_key and len(table._keys) > 0
+
+    def configure_checkpoints(self, enabled: bool, interval_chunks: int = DEFAULT_BATCH_CHUNKS):
+        self._checkpoints = enabled
+        self._batch_rows = max(1, interval_chunks) * CHUNK_ROWS
+
+    def csv_checkpoint_path(self) -> str:
+        return os.path.join(self._name, ".checkpoint.json")
+
+    def sql_checkpoint_path(self) -> str:
+        return f"{self._name}.sql.checkpoint.json"
+
+    def _open_checkpoint(self, path: str, dialect: str | None, resume: bool) -> Checkpoint | None:
+        if resume:
+            checkpoint = Checkpoint.load(path)
+            if checkpoint is None:
+                raise CheckpointMismatch(f"Cannot resume, checkpoint {path} does not exist")
+            checkpoint.check_compatible(self._digest, self._seed, dialect, CHUNK_ROWS, self._partitioning_description())
+            return checkpoint
+        # a stale checkpoint would point into the output that is about to be overwritten
+        if os.path.exists(path):
+            os.remove(path)
+        if not self._checkpoints:
+            return None
+        return Checkpoint(path, self._digest, self._seed, dialect, CHUNK_ROWS, self._partitioning_description())
+
+    def _partitioning_description(self) -> str | None:
+        return self._partitioning.describe() if self._partitioning else None
+
+    def _batches(self, table: DbTable, start: int, stop: int | None = None):
+        # with a memory limit every batch is sized from the memory left when it is generated
+        stop = table._quantity if stop is None else stop
+        lo = start
+        while lo < stop:
+            hi = min(lo + GOVERNOR.batch_rows(len(table._attributes), self._batch_rows, CHUNK_ROWS), stop)
+            yield lo, hi
+            lo = hi
+
+    def _pending(self, table: DbTable, checkpoint: Checkpoint | None) -> tuple[bool, int, dict[str, Any] | None]:
+        # (already complete, rows already written, position to resume from)
+        if checkpoint is None or checkpoint.offset(table._name) is None:
+            return False, 0, None
+        rows = checkpoint.rows_done(table._name)
+        return rows == table._quantity, rows, checkpoint.position(table._name)
+
+    def _open_parts(self, table: DbTable, extension: str, header: str, position: dict[str, Any] | None, pipeline: WritePipeline) -> PartitionedFile:
+        return PartitionedFile(self._name, table._name, extension, header, self._partitioning, table._quantity, position, pipeline)  # type: ignore
+
+    def _write_load_files(self, sql_dialect: SQLDialect, extension: str):
+        # the tables are created without foreign keys, those are added once all the parts are loaded
+        dialect = next(name for name, value in map_str_to_dialect.items() if value == sql_dialect)
+        with open(os.path.join(self._name, f"{dialect}.ddl.sql"), "w", newline="") as f:
+            self.write_ddl(f, sql_dialect)  # type: ignore
+        with open(os.path.join(self._name, f"{dialect}.constraints.sql"), "w", newline="") as f:
+            self.write_constraints(f, sql_dialect)  # type: ignore
+        write_load_script(self, self._name, extension, dialect)
+
+    def generate_csv(self, resume: bool = False):
+        self.generate(csv=True, resume_csv=resume)
+
+    def generate_sql(self, dialect: str = "postgres", resume: bool = False):
+        self.generate(dialect=dialect, resume_sql=resume)
+
+    def generate(self, csv: bool = False, dialect: str | None = None, resume_csv: bool = False, resume_sql: bool = False):
+        # the csv output and the sql output in the dialect are written from the same batches,
+        # every row is generated once whatever the formats. Each format has its own checkpoint
+        if dialect is not None and dialect not in map_str_to_dialect:
+            raise ValueError(f"Invalid dialect {dialect}")
+        sql_dialect = map_str_to_dialect[dialect] if dialect is not None else None
+        outputs: list[_Output] = []
+        if csv:
+            os.makedirs(self._name, exist_ok=True)
+            outputs.append(_Output(None, self._open_checkpoint(self.csv_checkpoint_path(), None, resume_csv)))
+        sql = None
+        if sql_dialect is not None:
+            if self._partitioning:
+                # the inserts of every table go in its part files, the tables and constraints in files of their own
+                os.makedirs(self._name, exist_ok=True)
+            sql = _Output(sql_dialect, self._open_checkpoint(self.sql_checkpoint_path(), dialect, resume_sql))
+            outputs.append(sql)
+        # the file of a table is still being written while the next table is generated
+        with WritePipeline(self._write_buffers) as pipeline, ExitStack() as files:
+            if sql is not None and self._partitioning is None:
+                # everything goes in a single file, so the last recorded offset is where to resume from
+                checkpoint = sql.checkpoint
+                sql.file = files.enter_context(ResumableFile(f"{self._name}.sql", checkpoint.last_offset() if checkpoint else None, pipeline))
+                if checkpoint is None or checkpoint.state["ddl_offset"] is None:
+                    self.write_ddl(sql.file, sql_dialect)  # type: ignore
+                    if checkpoint:
+                        checkpoint.record_ddl(sql.file)
+            for table in self.selected_tables:
+                self._generate_table(table, outputs, pipeline)
+            if sql is not None and sql.file is not None and self._sort_by_primary_key and (sql.checkpoint is None or sql.checkpoint.state.get("constraints_offset") is None):
+                self.write_constraints(sql.file, sql_dialect)  # type: ignore
+                if sql.checkpoint:
+                    sql.checkpoint.record_constraints(sql.file)
+        if self._partitioning:
+            if csv:
+                # psql's \copy is what loads csv parts in parallel
+                self._write_load_files(SQLDialect.POSTGRES, "csv")
+            if sql_dialect is not None:
+                self._write_load_files(sql_dialect, "sql")
+        # the pipeline is closed, so every record is saved, and a complete run has nothing to resume
+        for output in outputs:
+            if output.checkpoint:
+                output.checkpoint.remove()
+
+    def _generate_table(self, table: DbTable, outputs: list[_Output], pipeline: WritePipeline):
+        with ExitStack() as files:
+            pending: list[tuple[_Output, Any, int]] = []
+            for output in outputs:
+                done, rows_done, position = self._pending(table, output.checkpoint)
+                if done:
+                    continue
+                if output.file is not None:
+                    out = output.file
+                elif output.dialect is not None:
+                    out = files.enter_context(self._open_parts(table, "sql", "", position, pipeline))
+                elif self._partitioning:
+                    # every part starts with its own header
+                    header = RowLines()
+                    table._format_csv_rows(header, {}, 0, header=True)  # type: ignore
+                    out = files.enter_context(self._open_parts(table, "csv", "".join(header), position, pipeline))
+                else:
+                    out = files.enter_context(ResumableFile(os.path.join(self._name, f"{table._name}.csv"), position["offset"] if position else None, pipeline))
+                    if rows_done == 0:
+                        table.write_csv_rows(out, {}, 0, header=True)  # type: ignore
+                pending.append((output, out, rows_done))
+            if not pending:
+                return
+            # the output resumed earliest is where generation starts
+            first, _, first_done = min(pending, key=itemgetter(2))
+            statistics = self._table_statistics(table, first.checkpoint, first_done)
+            if self._sorted(table):
+                # sorted tables are only checkpointed once they are complete
+                write_sorted(self, table, [(out, output.dialect) for output, out, _ in pending], self._sort_workers, statistics)
+                self._write_statistics(table, statistics)
+                for output, out, _ in pending:
+                    if output.checkpoint:
+                        output.checkpoint.record(table._name, table._quantity, out)
+                return
+            # every batch is generated once and written to the outputs missing its rows. An output
+            # resumed further than another one starts later, batches end where it starts
+            starts = sorted({rows_done for _, _, rows_done in pending})
+            checkpointed = any(output.checkpoint for output, _, _ in pending)
+            bounds = zip(starts, starts[1:] + [table._quantity])
+            for lo, hi in chain.from_iterable(self._batches(table, start, stop) for start, stop in bounds):
+                columns = table.generate_rows(lo, hi)
+                state = None
+                if statistics is not None:
+                    statistics.add(columns, lo, hi)
+                    if hi == table._quantity:
+                        # written before the checkpoint marks the table as complete
+                        self._write_statistics(table, statistics)
+                    elif checkpointed:
+                        state = json.dumps(statistics.state())
+                for output, out, rows_done in pending:
+                    if lo < rows_done:
+                        continue
+                    if output.dialect is None:
+                        table.write_csv_rows(out, columns, hi - lo, header=False)  # type: ignore
+                    else:
+                        table.write_insertion_sql(out, columns, hi - lo, output.dialect)  # type: ignore
+                    if output.checkpoint:
+                        output.checkpoint.record(table._name, hi, out, state)
+            if table._quantity == 0:
+                self._write_statistics(table, statistics)
+                for output, out, _ in pending:
+                    if output.checkpoint:
+                        output.checkpoint.record(table._name, 0, out)
 
     def _gen_oracle_foreign_key(self, table: DbTable, foreign_key: DbAttribute, attr: DbAttribute) -> str:
         return f"ALTER TABLE {table._name} ADD CONSTRAINT FOREIGN KEY fk_{table._name} ({foreign_key._name}) REFERENCES {foreign_key._references.table._name}({attr._name});\n" # type: ignore
@@ -395,41 +1185,45 @@ class DbSchema:
         else:
             raise ValueError(f"Invalid dialect {dialect}")
 
-    def generate_sql(self, dialect: str = "postgres"):
-        dialect_mapping = {
-            "postgres": SQLDialect.POSTGRES,
-            "oracle": SQLDialect.ORACLE,
-        }
-        if dialect not in dialect_mapping:
-            raise ValueError(f"Invalid dialect {dialect}")
-        sql_dialect = dialect_mapping[dialect]
-        with open(f"{self._name}.sql", "w") as f:
-            for table in self._tables:
+    def write_ddl(self, f: TextIOWrapper, sql_dialect: SQLDialect):
+        with PROFILER.stage("ddl"):
+            for table in self.selected_tables:
                 if sql_dialect == SQLDialect.POSTGRES:
                     f.write(f"DROP TABLE IF EXISTS {table._name} CASCADE;\n") 
                 elif sql_dialect == SQLDialect.ORACLE:
                     f.write(f"DROP TABLE {table._name} CASCADE CONSTRAINTS;\n")
                 else:
-                    raise ValueError(f"Invalid dialect {dialect}")
-            for table in self._tables:
-                table.generate_sql(f, dialect=sql_dialect)
-            for table in self._tables:
-                for foreign_key in filter(
-                    lambda x: x._references, table._attributes.values()
-                ):
-                    attr = table._get_foreign_attribute(foreign_key)
-                    if attr is None:
-                        raise ValueError("Attribute for foreign key is None")
-                    if foreign_key._references is None:
-                        raise ValueError("Foreign key references is None")
-                    if isinstance(foreign_key._references.table, str):
-                        raise ValueError("Foreign key references table is string")
-                    f.write(
-                        self._gen_foreign_key(table, foreign_key, attr, sql_dialect)
-                    )
-            for table in self._tables:
-                table.generate_insertion_sql(f, dialect=sql_dialect)
+                    raise ValueError(f"Invalid dialect {sql_dialect}")
+            for table in self.selected_tables:
+                table.generate_sql(f, dialect=sql_dialect, primary_key=not self._sorted(table))
+            if not self._sort_by_primary_key and self._partitioning is None:
+                self._write_foreign_keys(f, sql_dialect)
 
+    def write_constraints(self, f: TextIOWrapper, sql_dialect: SQLDialect):
+        # with sorted output the primary keys are added after the data is loaded, so that their
+        # indexes are built from sorted input, and the foreign keys (which need them) after that
+        with PROFILER.stage("ddl"):
+            for table in self.selected_tables:
+                if self._sorted(table):
+                    f.write(table.primary_key_sql())
+            self._write_foreign_keys(f, sql_dialect)
+
+    def _write_foreign_keys(self, f: TextIOWrapper, sql_dialect: SQLDialect):
+        # a foreign key to an unselected table would reference rows which are not in the output
+        for table in self.selected_tables:
+            for foreign_key in filter(
+                lambda x: x._references and x._references.table._selected, table._attributes.values()  # type: ignore
+            ):
+                attr = table._get_foreign_attribute(foreign_key)
+                if attr is None:
+                    raise ValueError("Attribute for foreign key is None")
+                if foreign_key._references is None:
+                    raise ValueError("Foreign key references is None")
+                if isinstance(foreign_key._references.table, str):
+                    raise ValueError("Foreign key references table is string")
+                f.write(
+                    self._gen_foreign_key(table, foreign_key, attr, sql_dialect)
+                )
 
 class InvalidSchema(Exception):
     def __init__(self, message: str, base_exception: InvalidTable | None = None):
@@ -439,12 +1233,19 @@ class InvalidSchema(Exception):
         super().__init__(message)
 
 
-def parse_json_schema(filename: str) -> DbSchema:
+def parse_json_schema(filename: str, seed: int | None = None, scale_factor: float | None = None, sort_by_primary_key: bool | None = None) -> DbSchema:
     schemaname = os.path.splitext(os.path.basename(filename))[0]
-    with open(filename, "r") as file:
-        schema = json.load(file)
+    with PROFILER.stage("parse_json_schema") as scope:
+        with open(filename, "r") as file:
+            text = file.read()
+        schema = json.loads(text)
+        digest_input = text if scale_factor is None else f"{text}\0scale_factor={scale_factor}"
+        if sort_by_primary_key is not None:
+            digest_input += f"\0sort_by_primary_key={sort_by_primary_key}"
+        digest = hashlib.sha256(digest_input.encode("utf-8")).hexdigest()
+        scope.add(bytes=len(text))
     try:
-        return DbSchema(schemaname, schema)
+        return DbSchema(schemaname, schema, seed, digest, scale_factor, sort_by_primary_key)
     except InvalidTable as e:
         raise InvalidSchema(f"Schema {filename} is invalid", e)
     except KeyError as v:
@@ -0,0 +1,275 @@
+from __future__ import annotations
+from structureReader.reader import DbSchema, CHUNK_ROWS, map_str_to_dialect
+from structureReader.columnstats import TableStatistics, statistics_path
+from instrumentation.profiler import PROFILER
+from typing import Any
+import hashlib
+import json
+import os
+import subprocess
+import sys
+
+MANIFEST_VERSION = 1
+
+
+class InvalidShards(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+def shard_range(rows: int, shard_index: int, shard_count: int) -> tuple[int, int]:
+    # shards are cut on chunk boundaries, so every row is generated with the same rng state
+    # it would have in a single process run
+    chunks = (rows + CHUNK_ROWS - 1) // CHUNK_ROWS
+    lo = chunks * shard_index // shard_count * CHUNK_ROWS
+    hi = chunks * (shard_index + 1) // shard_count * CHUNK_ROWS
+    return min(lo, rows), min(hi, rows)
+
+
+def part_name(base: str, shard_index: int, shard_count: int) -> str:
+    return f"{base}.part-{shard_index:05d}-of-{shard_count:05d}"
+
+
+def manifest_name(shard_index: int, shard_count: int) -> str:
+    return part_name("manifest", shard_index, shard_count) + ".json"
+
+
+class _PartWriter:
+    # text sink that keeps a running checksum and byte count of what was written
+    def __init__(self, path: str):
+        self.path = path
+        self._file = open(path, "wb")
+        self._hash = hashlib.sha256()
+        self.bytes = 0
+
+    def write(self, text: str):
+        data = text.encode("utf-8")
+        self._hash.update(data)
+        self._file.write(data)
+        self.bytes += len(data)
+
+    def write_rows(self, rows: list[str]) -> int:
+        before = self.bytes
+        self.write("".join(rows))
+        return self.bytes - before
+
+    def close(self):
+        self._file.close()
+
+    @property
+    def sha256(self) -> str:
+        return self._hash.hexdigest()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+
+def generate_shard(schema: DbSchema, shard_index: int, shard_count: int, directory: str, csv: bool, dialect: str | None):
+    if not 0 <= shard_index < shard_count:
+        raise InvalidShards(f"Shard index {shard_index} is out of range for {shard_count} shards")
+    if schema.sort_by_primary_key:
+        # rows of a shard are a slice in generation order, sorted tables would have to be merged across shards
+        raise InvalidShards(f"Shards cannot be sorted by primary key")
+    os.makedirs(directory, exist_ok=True)
+    sql_dialect = map_str_to_dialect[dialect] if dialect else None
+    parts = []
+
+    def add_part(kind: str, table: str | None, rows: tuple[int, int], writer: _PartWriter):
+        parts.append({
+            "kind": kind,
+            "table": table,
+            "rows": list(rows),
+            "file": os.path.basename(writer.path),
+            "bytes": writer.bytes,
+            "sha256": writer.sha256,
+        })
+
+    if sql_dialect is not None and shard_index == 0:
+        # the DDL only depends on the schema, so only the first shard writes it
+        with _PartWriter(os.path.join(directory, part_name(f"{schema._name}.ddl", shard_index, shard_count) + ".sql")) as writer:
+            schema.write_ddl(writer, sql_dialect)  # type: ignore
+        add_part("ddl", None, (0, 0), writer)
+    tables = []
+    for table in schema.selected_tables:
+        lo, hi = shard_range(table._quantity, shard_index, shard_count)
+        tables.append({"name": table._name, "rows": table._quantity})
+        csv_writer = _PartWriter(os.path.join(directory, part_name(table._name, shard_index, shard_count) + ".csv")) if csv else None
+        sql_writer = _PartWriter(os.path.join(directory, part_name(table._name, shard_index, shard_count) + ".sql")) if sql_dialect is not None else None
+        statistics = TableStatistics.of(table) if schema._statistics else None
+        if csv_writer and lo == hi:
+            table.write_csv_rows(csv_writer, {}, 0, header=shard_index == 0)  # type: ignore
+        # the slice is generated in batches, so that a shard stays within the memory limit
+        for batch_lo, batch_hi in schema._batches(table, lo, hi):
+            columns = table.generate_rows(batch_lo, batch_hi)
+            if statistics is not None:
+                statistics.add(columns, batch_lo, batch_hi)
+            if csv_writer:
+                table.write_csv_rows(csv_writer, columns, batch_hi - batch_lo, header=shard_index == 0 and batch_lo == lo)  # type: ignore
+            if sql_writer:
+                table.write_insertion_sql(sql_writer, columns, batch_hi - batch_lo, sql_dialect)  # type: ignore
+            del columns
+        for kind, writer in (("csv", csv_writer), ("sql", sql_writer)):
+            if writer:
+                writer.close()
+                add_part(kind, table._name, (lo, hi), writer)
+        if statistics is not None:
+            # the sketches of the slice, merged with those of the other shards into the statistics of the table
+            with _PartWriter(os.path.join(directory, part_name(f"{table._name}.stats", shard_index, shard_count) + ".json")) as writer:
+                writer.write(json.dumps(statistics.state()))
+            add_part("stats", table._name, (lo, hi), writer)
+    manifest = {
+        "version": MANIFEST_VERSION,
+        "schema": schema._name,
+        "schema_sha256": schema.digest,
+        "seed": schema.seed,
+        "dialect": dialect,
+        "chunk_rows": CHUNK_ROWS,
+        "shard_index": shard_index,
+        "shard_count": shard_count,
+        "tables": tables,
+        "parts": parts,
+    }
+    # the manifest is written last, its presence marks the shard as complete
+    manifest_path = os.path.join(directory, manifest_name(shard_index, shard_count))
+    with open(manifest_path + ".tmp", "w") as f:
+        json.dump(manifest, f, indent=2)
+    os.replace(manifest_path + ".tmp", manifest_path)
+
+
+def _load_manifests(directory: str) -> list[dict[str, Any]]:
+    manifests = []
+    for filename in sorted(os.listdir(directory)):
+        if filename.startswith("manifest.part-") and filename.endswith(".json"):
+            with open(os.path.join(directory, filename), "r") as f:
+                manifests.append(json.load(f))
+    if len(manifests) == 0:
+        raise InvalidShards(f"No shard manifests found in {directory}")
+    return manifests
+
+
+def _file_digest(path: str) -> tuple[int, str]:
+    h = hashlib.sha256()
+    size = 0
+    with open(path, "rb") as f:
+        while block := f.read(1 << 20):
+            h.update(block)
+            size += len(block)
+    return size, h.hexdigest()
+
+
+def verify_shards(directory: str) -> list[dict[str, Any]]:
+    manifests = _load_manifests(directory)
+    first = manifests[0]
+    shard_count = first["shard_count"]
+    for key in ("version", "schema", "schema_sha256", "seed", "dialect", "chunk_rows", "shard_count", "tables"):
+        for manifest in manifests:
+            if manifest[key] != first[key]:
+                raise InvalidShards(f"Shard {manifest['shard_index']} disagrees with shard {first['shard_index']} on '{key}'")
+    indexes = sorted(manifest["shard_index"] for manifest in manifests)
+    if indexes != list(range(shard_count)):
+        missing = sorted(set(range(shard_count)) - set(indexes))
+        raise InvalidShards(f"Expected {shard_count} shards, missing shard(s) {', '.join(map(str, missing))}")
+    manifests.sort(key=lambda x: x["shard_index"])
+    kinds = {part["kind"] for manifest in manifests for part in manifest["parts"]} - {"ddl"}
+    for table in first["tables"]:
+        for kind in kinds:
+            expected_lo = 0
+            for manifest in manifests:
+                part = next(filter(lambda x: x["kind"] == kind and x["table"] == table["name"], manifest["parts"]), None)
+                if part is None:
+                    raise InvalidShards(f"Shard {manifest['shard_index']} has no {kind} part for table {table['name']}")
+                lo, hi = part["rows"]
+                if lo != expected_lo:
+                    raise InvalidShards(f"Table {table['name']} {kind} rows are not contiguous: shard {manifest['shard_index']} starts at {lo}, expected {expected_lo}")
+                expected_lo = hi
+            if expected_lo != table["rows"]:
+                raise InvalidShards(f"Table {table['name']} {kind} parts cover {expected_lo} rows out of {table['rows']}")
+    for manifest in manifests:
+        for part in manifest["parts"]:
+            path = os.path.join(directory, part["file"])
+            if not os.path.exists(path):
+                raise InvalidShards(f"Part file {part['file']} is missing")
+            size, digest = _file_digest(path)
+            if size != part["bytes"] or digest != part["sha256"]:
+                raise InvalidShards(f"Part file {part['file']} does not match its manifest (checksum or size differ)")
+    return manifests
+
+
+def _append_file(out, path: str):
+    with open(path, "rb") as f:
+        while block := f.read(1 << 20):
+            out.write(block)
+
+
+def merge_shards(directory: str, output_directory: str = "."):
+    with PROFILER.stage("verify_shards"):
+        manifests = verify_shards(directory)
+    first = manifests[0]
+    schema_name = first["schema"]
+
+    def parts_of(kind: str, table: str | None):
+        for manifest in manifests:
+            for part in manifest["parts"]:
+                if part["kind"] == kind and part["table"] == table:
+                    yield os.path.join(directory, part["file"])
+
+    kinds = {part["kind"] for manifest in manifests for part in manifest["parts"]}
+    with PROFILER.stage("merge_shards"):
+        if kinds & {"csv", "stats"}:
+            os.makedirs(os.path.join(output_directory, schema_name), exist_ok=True)
+        if "csv" in kinds:
+            for table in first["tables"]:
+                with open(os.path.join(output_directory, schema_name, f"{table['name']}.csv"), "wb") as out:
+                    for path in parts_of("csv", table["name"]):
+                        _append_file(out, path)
+        if "sql" in kinds:
+            with open(os.path.join(output_directory, f"{schema_name}.sql"), "wb") as out:
+                for path in parts_of("ddl", None):
+                    _append_file(out, path)
+                for table in first["tables"]:
+                    for path in parts_of("sql", table["name"]):
+                        _append_file(out, path)
+        if "stats" in kinds:
+            for table in first["tables"]:
+                statistics = None
+                for path in parts_of("stats", table["name"]):
+                    with open(path, "r") as f:
+                        shard_statistics = TableStatistics.from_state(json.load(f))
+                    if statistics is None:
+                        statistics = shard_statistics
+                    else:
+                        statistics.merge(shard_statistics)
+                if statistics is not None:
+                    statistics.write(statistics_path(os.path.join(output_directory, schema_name), table["name"]))
+
+
+def run_local_shards(script: str, schema_file: str, shard_count: int, directory: str, seed: int, scale_factor: float, csv: bool, dialect: str | None, tables: list[str] | None = None,
+                     memory_limit: float | None = None, statistics: bool = False):
+    # runs every shard as a separate local process and waits for all of them, sharing the memory limit (in MB)
+    if os.path.isdir(directory):
+        # manifests of a previous run with a different shard count would fail the merge
+        for filename in os.listdir(directory):
+            if filename.startswith("manifest.part-"):
+                os.remove(os.path.join(directory, filename))
+    procs = []
+    for index in range(shard_count):
+        args = [sys.executable, script, "--file", schema_file, "--seed", str(seed), "--scale-factor", repr(scale_factor),
+                "--shard-index", str(index), "--shard-count", str(shard_count), "--shard-dir", directory]
+        if csv:
+            args.append("--csv")
+        if dialect:
+            args += ["--sql", "--dialect", dialect]
+        if tables is not None:
+            args += ["--tables", ",".join(tables)]
+        if memory_limit is not None:
+            args += ["--memory-limit", repr(memory_limit / shard_count)]
+        if statistics:
+            args.append("--statistics")
+        procs.append(subprocess.Popen(args, stdout=subprocess.DEVNULL))
+    failed = [index for index, proc in enumerate(procs) if proc.wait() != 0]
+    if failed:
+        raise InvalidShards(f"Shard process(es) {', '.join(map(str, failed))} failed")
@@ -0,0 +1,164 @@
+from __future__ import annotations
+from concurrent.futures import ProcessPoolExecutor
+from itertools import repeat
+from operator import itemgetter
+from typing import Any, Iterable, Iterator, TYPE_CHECKING
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR
+from structureReader.keystore import KeyColumn
+from structureReader.columnstats import TableStatistics
+from structureReader.writer import RowLines
+import heapq
+import os
+import pickle
+import shutil
+import tempfile
+
+if TYPE_CHECKING:
+    from structureReader.reader import DbSchema, DbTable, SQLDialect
+
+# runs are written and read back in blocks of this many rows
+RUN_BLOCK_ROWS = 1024
+# maximum number of runs merged at once, tables with more runs are merged in several passes
+MERGE_FAN_IN = 64
+
+
+class InvalidSort(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+def _write_run(path: str, records: Iterable[tuple[tuple, tuple[str, ...]]]):
+    with open(path, "wb") as f:
+        block = []
+        for record in records:
+            block.append(record)
+            if len(block) == RUN_BLOCK_ROWS:
+                pickle.dump(block, f, protocol=pickle.HIGHEST_PROTOCOL)
+                block = []
+        if block:
+            pickle.dump(block, f, protocol=pickle.HIGHEST_PROTOCOL)
+
+
+def _read_run(path: str) -> Iterator[tuple[tuple, tuple[str, ...]]]:
+    with open(path, "rb") as f:
+        while True:
+            try:
+                block = pickle.load(f)
+            except EOFError:
+                return
+            yield from block
+
+
+def _merged(paths: list[str]) -> Iterator[tuple[tuple, tuple[str, ...]]]:
+    # heapq.merge is stable, equal keys come out in run order and so in row order
+    return heapq.merge(*map(_read_run, paths), key=itemgetter(0))
+
+
+def sorted_run(table: DbTable, lo: int, hi: int, dialects: list[SQLDialect | None], path: str, spill: bool = True, statistics: TableStatistics | None = None):
+    # formats rows [lo, hi) of the table in every output format (None is csv) and writes them to path
+    # ordered by primary key, every record holding the key and the row in each format
+    columns = table.generate_rows(lo, hi, spill)
+    if statistics is not None:
+        statistics.add(columns, lo, hi)
+    formatted = []
+    for dialect in dialects:
+        lines = RowLines()
+        if dialect is None:
+            table._format_csv_rows(lines, columns, hi - lo, header=False)  # type: ignore
+        else:
+            table._format_insertion_sql(lines, columns, hi - lo, dialect)  # type: ignore
+        formatted.append(lines)
+    # strings compare by code point, the order of the C collation and not necessarily the database's
+    keys = zip(*(columns[key._name] for key in table._keys))
+    _write_run(path, sorted(zip(keys, zip(*formatted)), key=itemgetter(0)))
+    return path
+
+
+_WORKER_TABLES: dict[str, DbTable] = {}
+
+
+def _init_worker(name: str, source: dict[str, Any], seed: int, scale_factor: float, key_columns: list[tuple[str, str, str, Any, int]]):
+    # every worker rebuilds the schema, the referenced key columns are shared through their memory mapped files
+    from structureReader.reader import DbSchema
+    schema = DbSchema(name, source, seed, scale_factor=scale_factor)
+    _WORKER_TABLES.update({table._name: table for table in schema._tables})
+    for table, attribute, path, db_type, count in key_columns:
+        _WORKER_TABLES[table]._attributes[attribute]._data = KeyColumn(path, db_type, count)
+
+
+def _worker_run(table: str, lo: int, hi: int, dialects: list[SQLDialect | None], path: str, statistics: bool) -> TableStatistics | None:
+    # the statistics of the batch go back to the parent, which merges them in batch order
+    batch_statistics = TableStatistics.of(_WORKER_TABLES[table]) if statistics else None
+    sorted_run(_WORKER_TABLES[table], lo, hi, dialects, path, spill=False, statistics=batch_statistics)
+    return batch_statistics
+
+
+def _shared_key_columns(table: DbTable) -> list[tuple[str, str, str, Any, int]] | None:
+    key_columns = []
+    for attribute in table._attributes.values():
+        if fk_attr := table._get_foreign_attribute(attribute):
+            parent = attribute._references.table  # type: ignore
+            column = parent.key_column(fk_attr)
+            if not isinstance(column, KeyColumn) or column.path is None:
+                # held in memory or its files are unlinked, the batches are sorted in this process
+                return None
+            key_columns.append((parent._name, fk_attr._name, column.path, column.type, len(column)))
+    return key_columns
+
+
+def write_sorted(schema: DbSchema, table: DbTable, outputs: list[tuple[Any, SQLDialect | None]], workers: int, statistics: TableStatistics | None = None):
+    # external merge sort: every batch becomes a sorted run file (in parallel when possible),
+    # then the runs are merged MERGE_FAN_IN at a time, so memory is bounded by the batch size.
+    # The runs hold the rows in the format of every (file, dialect) output, which are all written by
+    # the last merge. The statistics of the table are gathered from the batches as they are generated
+    dialects = [dialect for _, dialect in outputs]
+    ranges = list(schema._batches(table, 0))
+    directory = tempfile.mkdtemp(prefix=f".{schema._name}-sort-", dir=os.getcwd())
+    try:
+        paths = [os.path.join(directory, f"run-{i}") for i in range(len(ranges))]
+        with PROFILER.stage("sort_runs", table._name) as scope:
+            # every sort worker holds a batch of its own
+            workers = GOVERNOR.workers(workers, max((hi - lo for lo, hi in ranges), default=0), len(table._attributes))
+            key_columns = _shared_key_columns(table) if workers > 1 and len(ranges) > 1 else None
+            if key_columns is None:
+                for (lo, hi), path in zip(ranges, paths):
+                    sorted_run(table, lo, hi, dialects, path, statistics=statistics)
+            else:
+                with ProcessPoolExecutor(
+                    max_workers=min(workers, len(ranges)),
+                    initializer=_init_worker,
+                    initargs=(schema._name, schema._source, schema.seed, schema.scale_factor, key_columns),
+                ) as pool:
+                    for batch_statistics in pool.map(_worker_run, repeat(table._name), *zip(*ranges), repeat(dialects), paths, repeat(statistics is not None)):
+                        if statistics is not None:
+                            statistics.merge(batch_statistics)
+            scope.add(rows=table._quantity)
+        with PROFILER.stage("merge_runs", table._name) as scope:
+            generation = 0
+            while len(paths) > MERGE_FAN_IN:
+                merged = []
+                for i in range(0, len(paths), MERGE_FAN_IN):
+                    group = paths[i:i + MERGE_FAN_IN]
+                    path = os.path.join(directory, f"merge-{generation}-{len(merged)}")
+                    _write_run(path, _merged(group))
+                    for run in group:
+                        os.remove(run)
+                    merged.append(path)
+                paths = merged
+                generation += 1
+            written = 0
+            blocks: list[list[str]] = [[] for _ in outputs]
+            for _, lines in _merged(paths):
+                for block, line in zip(blocks, lines):
+                    block.append(line)
+                if len(blocks[0]) == RUN_BLOCK_ROWS:
+                    for (out, _), block in zip(outputs, blocks):
+                        written += out.write_rows(block)
+                        block.clear()
+            if blocks[0]:
+                for (out, _), block in zip(outputs, blocks):
+                    written += out.write_rows(block)
+            scope.add(rows=table._quantity, bytes=written)
+    finally:
+        shutil.rmtree(directory, ignore_errors=True)
@@ -0,0 +1,24 @@
+from structureReader.calibration import calibrate, CALIBRATION_VERSION
+from structureReader.testing import GeneratorTestCase
+import json
+import unittest
+
+
+class CalibrationTest(GeneratorTestCase):
+    def test_calibration_has_every_rate_the_estimator_reads(self):
+        calibrate("calibration.json", rows=500)
+        with open("calibration.json") as f:
+            calibration = json.load(f)
+        self.assertEqual(calibration["version"], CALIBRATION_VERSION)
+        rates = calibration["generator_rows_per_second"]
+        # keys are TYPE.GENERATION as the UI builds them from the schema
+        for key in ("INTEGER.RANDOM", "INTEGER.INCREASING", "STRING.NAMESURNAME", "DATE.INCREASING", "REAL.ENUM", "FOREIGN_KEY"):
+            self.assertIn(key, rates)
+        self.assertTrue(all(rate > 0 for rate in rates.values()))
+        for key in ("csv_bytes_per_second", "sql_bytes_per_second", "disk_bytes_per_second"):
+            self.assertGreater(calibration[key], 0)
+        self.assertGreater(calibration["dictionaries"]["surname"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,69 @@
+from structureReader.checkpoint import Checkpoint
+from structureReader.testing import GeneratorTestCase, GENERATOR
+import os
+import shutil
+import subprocess
+import sys
+import time
+import unittest
+
+ROWS = 200000
+TABLES = [
+    {"name": "T", "rows": ROWS, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "s", "type": "string", "length": 20},
+        {"name": "x", "type": "real", "generation": "random", "step": 100}]},
+]
+
+
+class ResumeTest(GeneratorTestCase):
+    def interrupt(self, *args: str):
+        # kills a checkpointed run once its first checkpoint of T was saved
+        proc = subprocess.Popen([sys.executable, GENERATOR, *args], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            path = os.path.join("big", ".checkpoint.json")
+            while proc.poll() is None:
+                checkpoint = Checkpoint.load(path) if os.path.exists(path) else None
+                if checkpoint is not None and checkpoint.rows_done("T") > 0:
+                    break
+                time.sleep(0.01)
+        finally:
+            proc.kill()
+            proc.wait()
+        checkpoint = Checkpoint.load(os.path.join("big", ".checkpoint.json"))
+        if checkpoint is None or checkpoint.rows_done("T") == ROWS:
+            self.skipTest("the run completed before it could be interrupted")
+        return checkpoint
+
+    def test_resumed_run_equals_an_uninterrupted_one(self):
+        schema = self.write_schema("big", TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "5")
+        os.makedirs("complete")
+        shutil.move("big", os.path.join("complete", "big"))
+        shutil.move("big.sql", os.path.join("complete", "big.sql"))
+        self.interrupt("-f", schema, "-c", "-s", "--seed", "5", "--checkpoint", "--checkpoint-interval", "1")
+        # the seed is taken from the checkpoint
+        result = self.generate("-f", schema, "-c", "-s", "--resume")
+        self.assertIn("Using seed 5", result.stdout)
+        self.assertEqual(self.read_tree("big"), self.read_tree(os.path.join("complete", "big")))
+        self.assertEqual(self.read("big.sql"), self.read(os.path.join("complete", "big.sql")))
+        self.assertFalse(os.path.exists(os.path.join("big", ".checkpoint.json")))
+        self.assertFalse(os.path.exists("big.sql.checkpoint.json"))
+
+    def test_resume_with_another_seed_is_refused(self):
+        schema = self.write_schema("big", TABLES)
+        checkpoint = self.interrupt("-f", schema, "-c", "--seed", "5", "--checkpoint", "--checkpoint-interval", "1")
+        result = self.generate("-f", schema, "-c", "--seed", "6", "--resume", check=False)
+        self.assertEqual(result.returncode, 1)
+        self.assertIn("Cannot resume", result.stdout)
+        self.assertEqual(Checkpoint.load(checkpoint.path).state, checkpoint.state)
+
+    def test_complete_run_leaves_no_checkpoint(self):
+        schema = self.write_schema("small", [dict(TABLES[0], rows=10000)])
+        self.generate("-f", schema, "-c", "-s", "--seed", "5", "--checkpoint", "--checkpoint-interval", "1")
+        self.assertEqual(os.listdir("small"), ["T.csv"])
+        self.assertFalse(os.path.exists("small.sql.checkpoint.json"))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,87 @@
+from structureReader.columnstats import ColumnStatistics, EXACT_DISTINCT
+from structureReader.testing import GeneratorTestCase
+from typeWrappers.types import DbType
+import json
+import os
+import random
+import unittest
+
+
+def statistics(values: list, db_type: DbType = DbType.INTEGER, batches: int = 1) -> ColumnStatistics:
+    # the values added in batches by separate statistics, merged in order
+    size = -(-len(values) // batches)
+    merged = None
+    for lo in range(0, len(values), size):
+        column = ColumnStatistics("c", db_type)
+        column.add(values[lo:lo + size], list(range(min(size, len(values) - lo))))
+        if merged is None:
+            merged = column
+        else:
+            merged.merge(column)
+    return merged  # type: ignore
+
+
+class ColumnStatisticsTest(unittest.TestCase):
+    def test_exact_counts_and_bounds(self):
+        summary = statistics([3, None, 7, 3, -1, None, 3], batches=3).summary()
+        self.assertEqual((summary["rows"], summary["nulls"], summary["min"], summary["max"]), (7, 2, -1, 7))
+        self.assertEqual((summary["distinct"], summary["distinct_exact"]), (3, True))
+        self.assertEqual(summary["top_values"][0], {"value": 3, "count": 3, "fraction": 3 / 7})
+        self.assertTrue(summary["top_values_exact"])
+
+    def test_distinct_values_are_estimated_past_the_exact_limit(self):
+        rng = random.Random(1)
+        values = [rng.randrange(1 << 40) for _ in range(4 * EXACT_DISTINCT)]
+        summary = statistics(values, batches=4).summary()
+        self.assertFalse(summary["distinct_exact"])
+        self.assertAlmostEqual(summary["distinct"] / len(set(values)), 1, delta=0.05)
+
+    def test_merged_batches_equal_a_single_pass(self):
+        rng = random.Random(2)
+        values = [rng.choice(["a", "b", "c", None]) for _ in range(3000)]
+        self.assertEqual(statistics(values, DbType.STRING, 5).summary(), statistics(values, DbType.STRING).summary())
+
+    def test_state_round_trips(self):
+        column = statistics([1.5, 2.5, None, 1.5], DbType.REAL)
+        restored = ColumnStatistics.from_state(json.loads(json.dumps(column.state())))
+        self.assertEqual(restored.summary(), column.summary())
+
+
+class StatisticsSidecarTest(GeneratorTestCase):
+    TABLES = [
+        {"name": "P", "rows": 1000, "primary_keys": ["id"], "attributes": [
+            {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1}]},
+        {"name": "C", "rows": 30000, "attributes": [
+            {"name": "pid", "type": "foreign_key", "references": {"table": "P", "attribute": "id"}},
+            {"name": "kind", "type": "string", "generation": "enum", "values": ["x", "y"], "null_fraction": 0.5},
+            {"name": "x", "type": "real", "generation": "random", "step": 10}]},
+    ]
+
+    def sidecar(self, table: str) -> dict:
+        with open(os.path.join("stats", f"{table}.stats.json")) as f:
+            return json.load(f)
+
+    def test_sidecars_describe_the_output_however_it_was_generated(self):
+        schema = self.write_schema("stats", self.TABLES)
+        self.generate("-f", schema, "-c", "--seed", "5", "--statistics")
+        single = {table: self.sidecar(table) for table in ("P", "C")}
+        columns = single["C"]["columns"]
+        self.assertEqual(columns["pid"]["rows"], 30000)
+        self.assertGreaterEqual(columns["pid"]["min"], 1)
+        self.assertLessEqual(columns["pid"]["max"], 1000)
+        self.assertAlmostEqual(columns["kind"]["null_fraction"], 0.5, delta=0.02)
+        self.assertEqual(columns["kind"]["distinct"], 2)
+        self.assertEqual(single["P"]["columns"]["id"]["distinct"], 1000)
+        bounds = columns["x"]["histogram"]["bounds"]
+        self.assertEqual(len(bounds), 33)
+        self.assertEqual((bounds[0], bounds[-1]), (columns["x"]["min"], columns["x"]["max"]))
+        self.assertEqual(bounds, sorted(bounds))
+        # shards and sort workers merge their sketches into the same file
+        self.generate("-f", schema, "-c", "--seed", "5", "--statistics", "--local-shards", "3")
+        self.assertEqual({table: self.sidecar(table) for table in ("P", "C")}, single)
+        self.generate("-f", schema, "-c", "--seed", "5", "--statistics", "--sort-by-primary-key", "--sort-workers", "2")
+        self.assertEqual(self.sidecar("C"), single["C"])
+
+
+if __name__ == "__main__":
+    unittest.main()
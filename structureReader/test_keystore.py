@@ -0,0 +1,109 @@
+from structureReader.keystore import KeyStore
+from structureReader.testing import GeneratorTestCase
+from typeWrappers.types import DbType
+from datetime import datetime
+import csv
+import os
+import shutil
+import tempfile
+import unittest
+
+VALUES = {
+    DbType.INTEGER: [5, -3, 0, 1 << 62],
+    DbType.REAL: [0.5, -1e300, 2.25],
+    DbType.STRING: ["a", "", "O'Hara", "naïve ☃"],
+    DbType.DATE: [datetime(2020, 1, 1), datetime(1969, 12, 31, 23, 59, 59, 123456)],
+}
+
+
+class KeyStoreTest(unittest.TestCase):
+    def setUp(self):
+        self.parent = tempfile.mkdtemp(prefix="mockdb-test-")
+
+    def tearDown(self):
+        shutil.rmtree(self.parent, ignore_errors=True)
+
+    def spill(self, store: KeyStore, db_type: DbType, values: list):
+        writer = store.writer("T", db_type.name.lower(), db_type)
+        writer.append(values[:1])
+        writer.append(values[1:])
+        return store.finish(writer)
+
+    def key_directories(self) -> list[str]:
+        return sorted(name for name in os.listdir(self.parent) if name.startswith(".schema-keys-"))
+
+    def test_spilled_columns_read_back_every_value(self):
+        for shared in (True, False):
+            store = KeyStore("schema", self.parent)
+            store.shared = shared
+            try:
+                for db_type, values in VALUES.items():
+                    column = self.spill(store, db_type, values)
+                    self.assertEqual(len(column), len(values))
+                    self.assertEqual([column[i] for i in range(len(values))], values)
+                    self.assertEqual(column.take([1, 0, 1]), [values[1], values[0], values[1]])
+                    with self.assertRaises(IndexError):
+                        column[len(values)]
+            finally:
+                store.close()
+            self.assertEqual(self.key_directories(), [])
+
+    @unittest.skipUnless(os.name == "posix", "open files cannot be unlinked")
+    def test_only_shared_columns_keep_their_files(self):
+        store = KeyStore("schema", self.parent)
+        store.shared = False
+        try:
+            column = self.spill(store, DbType.STRING, VALUES[DbType.STRING])
+            self.assertIsNone(column.path)
+            directory, = self.key_directories()
+            self.assertEqual(os.listdir(os.path.join(self.parent, directory)), [".lock"])
+            store.shared = True
+            column = self.spill(store, DbType.INTEGER, VALUES[DbType.INTEGER])
+            self.assertTrue(os.path.exists(column.path))
+        finally:
+            store.close()
+
+    def test_directories_of_dead_runs_are_removed(self):
+        abandoned = os.path.join(self.parent, ".schema-keys-abandoned")
+        os.makedirs(abandoned)
+        with open(os.path.join(abandoned, ".lock"), "wb"), open(os.path.join(abandoned, "T.id.keys"), "wb"):
+            pass
+        live = KeyStore("schema", self.parent)
+        try:
+            self.spill(live, DbType.INTEGER, VALUES[DbType.INTEGER])
+            self.assertFalse(os.path.exists(abandoned))
+            live_directory, = self.key_directories()
+            other = KeyStore("schema", self.parent)
+            try:
+                self.spill(other, DbType.INTEGER, VALUES[DbType.INTEGER])
+                # the directory of a live store is locked and stays
+                self.assertIn(live_directory, self.key_directories())
+                self.assertEqual(len(self.key_directories()), 2)
+            finally:
+                other.close()
+        finally:
+            live.close()
+        self.assertEqual(self.key_directories(), [])
+
+
+class SpilledForeignKeyTest(GeneratorTestCase):
+    def test_foreign_keys_reference_existing_rows(self):
+        schema = self.write_schema("fk", [
+            {"name": "P", "rows": 3000, "primary_keys": ["code"], "attributes": [
+                {"name": "code", "type": "string", "length": 10}]},
+            {"name": "C", "rows": 20000, "attributes": [
+                {"name": "code", "type": "foreign_key", "references": {"table": "P", "attribute": "code"}}]}])
+        self.generate("-f", schema, "-c", "--seed", "2")
+        with open(os.path.join("fk", "P.csv"), newline="") as f:
+            codes = {row["code"] for row in csv.DictReader(f)}
+        with open(os.path.join("fk", "C.csv"), newline="") as f:
+            references = [row["code"] for row in csv.DictReader(f)]
+        self.assertEqual(len(codes), 3000)
+        self.assertEqual(len(references), 20000)
+        self.assertTrue(set(references) <= codes)
+        # nothing is left of the spilled key columns
+        self.assertEqual([name for name in os.listdir() if name.startswith(".fk-keys-")], [])
+
+
+if __name__ == "__main__":
+    unittest.main()
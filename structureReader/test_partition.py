@@ -0,0 +1,75 @@
+from structureReader.partition import PartitionSpec, InvalidPartitioning
+from structureReader.testing import GeneratorTestCase
+import glob
+import os
+import shutil
+import subprocess
+import unittest
+
+TABLES = [
+    {"name": "P", "rows": 1000, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        # quoted values with line breaks must not be cut
+        {"name": "note", "type": "string", "generation": "enum", "values": ["two\nlines", "one, \"quoted\"", "plain"]}]},
+    {"name": "C", "rows": 10000, "attributes": [
+        {"name": "pid", "type": "foreign_key", "references": {"table": "P", "attribute": "id"}},
+        {"name": "s", "type": "string", "length": 10}]},
+]
+
+
+class PartitionSpecTest(unittest.TestCase):
+    def test_the_smallest_parts_win(self):
+        self.assertEqual(PartitionSpec(parts=4).rows_per_part(10), 3)
+        self.assertEqual(PartitionSpec(parts=4, max_rows=2).rows_per_part(10), 2)
+        self.assertEqual(PartitionSpec(parts=20).rows_per_part(10), 1)
+        self.assertIsNone(PartitionSpec(max_megabytes=1).rows_per_part(10))
+        for options in ({"parts": 0}, {"max_rows": -1}, {"max_megabytes": 0}):
+            with self.subTest(options=options), self.assertRaises(InvalidPartitioning):
+                PartitionSpec(**options)
+
+
+class PartFilesTest(GeneratorTestCase):
+    def parts(self, table: str, extension: str) -> list[bytes]:
+        return [self.read(path) for path in sorted(glob.glob(os.path.join("shop", f"{table}.part-*.{extension}")))]
+
+    def test_parts_hold_exactly_the_rows_of_the_unsplit_output(self):
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "2")
+        os.makedirs("whole")
+        shutil.move("shop", os.path.join("whole", "shop"))
+        sql = self.read("shop.sql")
+        self.generate("-f", schema, "-c", "-s", "--seed", "2", "--parts", "3", "--part-rows", "3000")
+        for table, count in (("P", 3), ("C", 4)):
+            csv_parts = self.parts(table, "csv")
+            self.assertEqual(len(csv_parts), count)
+            header = csv_parts[0][:csv_parts[0].index(b"\r\n") + 2]
+            self.assertTrue(all(part.startswith(header) for part in csv_parts))
+            self.assertEqual(header + b"".join(part[len(header):] for part in csv_parts),
+                             self.read(os.path.join("whole", "shop", f"{table}.csv")))
+            sql_parts = self.parts(table, "sql")
+            self.assertEqual(len(sql_parts), count)
+            self.assertIn(b"".join(sql_parts), sql)
+        self.assertTrue(os.access(os.path.join("shop", "load-csv.sh"), os.X_OK))
+        # fewer parts replace the parts of an earlier run
+        self.generate("-f", schema, "-c", "--seed", "2", "--parts", "2")
+        self.assertEqual(len(self.parts("C", "csv")), 2)
+
+    def test_load_script_loads_referenced_tables_first(self):
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "2", "--part-size", "0.05")
+        with open(os.path.join("shop", "load-sql.sh")) as f:
+            script = f.read()
+        self.assertLess(script.index("for table in P;"), script.index("for table in C;"))
+        self.assertLess(script.index("postgres.ddl.sql"), script.index("for table in P;"))
+        self.assertGreater(script.index("postgres.constraints.sql"), script.index("for table in C;"))
+        self.assertIn("FOREIGN KEY", self.read(os.path.join("shop", "postgres.constraints.sql")).decode())
+        self.assertNotIn("FOREIGN KEY", self.read(os.path.join("shop", "postgres.ddl.sql")).decode())
+        if shutil.which("sh"):
+            subprocess.run(["sh", "-n", os.path.join("shop", "load-sql.sh")], check=True)
+        # parts are cut before the row which would make them too large
+        self.assertGreater(len(self.parts("C", "csv")), 1)
+        self.assertTrue(all(len(part) <= int(0.05 * 1024 * 1024) for part in self.parts("C", "csv")))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,104 @@
+from structureReader.reader import DbSchema, InvalidSchema, _csv_cell
+from structureReader.testing import GeneratorTestCase
+from datetime import datetime
+import csv
+import io
+import os
+import random
+import shutil
+import unittest
+
+
+def table(name: str, rows: int, scaling: str | dict | None = None) -> dict:
+    attributes = [{"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1}]
+    return {"name": name, "rows": rows, "primary_keys": ["id"], "attributes": attributes,
+            **({"scaling": scaling} if scaling is not None else {})}
+
+
+class ScaleFactorTest(GeneratorTestCase):
+    def quantities(self, tables: list[dict], override: float | None = None, **options) -> dict[str, int]:
+        schema = DbSchema("scaled", {"tables": tables, **options}, 1, scale_factor=override)
+        try:
+            return {table._name: table._quantity for table in schema._tables}
+        finally:
+            schema.close()
+
+    def test_row_counts_follow_the_scaling_rules(self):
+        tables = [
+            table("customers", 150, "linear"),
+            table("nations", 25, "fixed"),
+            table("orders", 1500, {"mode": "proportional", "table": "customers"}),
+            table("lines", 10, {"mode": "proportional", "table": "orders", "ratio": 4}),
+        ]
+        self.assertEqual(self.quantities(tables), {"customers": 150, "nations": 25, "orders": 1500, "lines": 6000})
+        self.assertEqual(self.quantities(tables, 10), {"customers": 1500, "nations": 25, "orders": 15000, "lines": 60000})
+        self.assertEqual(self.quantities(tables, 0.1), {"customers": 15, "nations": 25, "orders": 150, "lines": 600})
+        # the command line overrides the scale factor of the schema
+        self.assertEqual(self.quantities(tables, 2, scale_factor=10)["customers"], 300)
+        self.assertEqual(self.quantities(tables, None, scale_factor=10)["customers"], 1500)
+
+    def test_cyclic_proportional_scaling_is_invalid(self):
+        tables = [table("a", 10, {"mode": "proportional", "table": "b"}), table("b", 10, {"mode": "proportional", "table": "a"})]
+        with self.assertRaises(InvalidSchema):
+            self.quantities(tables)
+
+    def test_scaled_csv_has_the_scaled_row_counts(self):
+        schema = self.write_schema("scaled", [table("customers", 100), table("nations", 25, "fixed"),
+                                              table("orders", 400, {"mode": "proportional", "table": "customers"})])
+        self.generate("-f", schema, "-c", "--seed", "1", "--scale-factor", "3")
+        for name, rows in (("customers", 300), ("nations", 25), ("orders", 1200)):
+            with open(os.path.join("scaled", f"{name}.csv"), "rb") as f:
+                lines = f.read().split(b"\r\n")
+            # header, rows and the empty string after the last line break
+            self.assertEqual(len(lines), rows + 2)
+            self.assertEqual(lines[-2], str(rows).encode())
+
+
+class SelectTablesTest(GeneratorTestCase):
+    TABLES = [
+        {"name": "P", "rows": 500, "primary_keys": ["id"], "attributes": [
+            {"name": "id", "type": "integer", "generation": "random", "step": 100000}]},
+        {"name": "C", "rows": 2000, "primary_keys": ["cid"], "attributes": [
+            {"name": "cid", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+            {"name": "pid", "type": "foreign_key", "references": {"table": "P", "attribute": "id"}}]},
+        {"name": "G", "rows": 3000, "attributes": [
+            {"name": "pid", "type": "foreign_key", "references": {"table": "C", "attribute": "pid"}},
+            {"name": "s", "type": "string", "length": 6}]},
+    ]
+
+    def test_selected_tables_have_the_rows_of_a_full_run(self):
+        schema = self.write_schema("sel", self.TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "4")
+        os.makedirs("full")
+        shutil.move("sel", os.path.join("full", "sel"))
+        result = self.generate("-f", schema, "-c", "-s", "--seed", "4", "--tables", "G")
+        self.assertIn("Sampling keys from P, C", result.stdout)
+        self.assertEqual(os.listdir("sel"), ["G.csv"])
+        self.assertEqual(self.read(os.path.join("sel", "G.csv")), self.read(os.path.join("full", "sel", "G.csv")))
+        sql = self.read("sel.sql").decode()
+        self.assertNotIn("CREATE TABLE C", sql)
+        self.assertNotIn("FOREIGN KEY", sql)
+
+    def test_generate_false_in_the_schema_and_unknown_tables(self):
+        tables = [dict(table, generate=False) if table["name"] == "P" else table for table in self.TABLES]
+        schema = self.write_schema("sel", tables)
+        self.generate("-f", schema, "-c", "--seed", "4")
+        self.assertEqual(sorted(os.listdir("sel")), ["C.csv", "G.csv"])
+        result = self.generate("-f", schema, "-c", "--seed", "4", "--tables", "C,nope", check=False)
+        self.assertEqual(result.returncode, 1)
+        self.assertIn("nope", result.stdout)
+
+
+class CsvCellTest(unittest.TestCase):
+    def test_cells_are_escaped_like_the_csv_writer(self):
+        rng = random.Random(3)
+        values = [None, 0, -2.5, datetime(2020, 1, 2, 3, 4, 5), "", "plain"]
+        values += ["".join(rng.choice('ab ,"\n\r\'') for _ in range(rng.randint(1, 6))) for _ in range(2000)]
+        for value in values:
+            expected = io.StringIO()
+            csv.writer(expected).writerow([value, "x"])
+            self.assertEqual(_csv_cell(value) + ",x\r\n", expected.getvalue(), repr(value))
+
+
+if __name__ == "__main__":
+    unittest.main()
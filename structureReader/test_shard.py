@@ -0,0 +1,46 @@
+from structureReader.testing import GeneratorTestCase
+import os
+import shutil
+import unittest
+
+TABLES = [
+    {"name": "P", "rows": 5000, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "r", "type": "real", "generation": "repeating", "start": 0, "step": 2.5},
+        {"name": "d", "type": "date", "generation": "increasing", "start": "2020-01-01", "step": {"days": 1}}]},
+    {"name": "C", "rows": 20000, "attributes": [
+        {"name": "cid", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "pid", "type": "foreign_key", "references": {"table": "P", "attribute": "id"}},
+        {"name": "s", "type": "string", "length": 8}]},
+]
+
+
+class ShardTest(GeneratorTestCase):
+    def test_merged_shards_equal_a_single_run(self):
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "-c", "-s", "--seed", "3")
+        os.makedirs("single")
+        shutil.move("shop", os.path.join("single", "shop"))
+        shutil.move("shop.sql", os.path.join("single", "shop.sql"))
+        self.generate("-f", schema, "-c", "-s", "--seed", "3", "--local-shards", "3")
+        self.assertEqual(self.read_tree("shop"), self.read_tree(os.path.join("single", "shop")))
+        self.assertEqual(self.read("shop.sql"), self.read(os.path.join("single", "shop.sql")))
+
+    def test_verify_rejects_missing_and_modified_parts(self):
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "-c", "--seed", "3", "--shard-index", "0", "--shard-count", "2")
+        result = self.generate("--verify", "shop_shards", check=False)
+        self.assertEqual(result.returncode, 1)
+        self.generate("-f", schema, "-c", "--seed", "3", "--shard-index", "1", "--shard-count", "2")
+        self.generate("--verify", "shop_shards")
+        part = next(name for name in sorted(os.listdir("shop_shards")) if name.endswith(".csv"))
+        with open(os.path.join("shop_shards", part), "ab") as f:
+            f.write(b"1,2,3\r\n")
+        result = self.generate("--merge", "shop_shards", check=False)
+        self.assertEqual(result.returncode, 1)
+        self.assertIn("does not match its manifest", result.stdout)
+        self.assertFalse(os.path.exists("shop"))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,63 @@
+from structureReader import sort
+from structureReader.reader import DbSchema
+from structureReader.testing import GeneratorTestCase
+from unittest import mock
+import csv
+import os
+import unittest
+
+SOURCE = {"tables": [
+    {"name": "P", "rows": 3000, "primary_keys": ["code"], "attributes": [
+        {"name": "code", "type": "string", "length": 10},
+        {"name": "x", "type": "integer", "generation": "random", "step": 50}]},
+    {"name": "C", "rows": 20000, "primary_keys": ["k"], "attributes": [
+        {"name": "k", "type": "integer", "generation": "random", "step": 1000000},
+        {"name": "code", "type": "foreign_key", "references": {"table": "P", "attribute": "code"}}]},
+]}
+
+
+class RunMergeTest(GeneratorTestCase):
+    def test_merge_keeps_equal_keys_in_run_order(self):
+        runs = [[((1,), ("a",)), ((3,), ("b",))], [((1,), ("c",)), ((2,), ("d",))], [((3,), ("e",))]]
+        paths = []
+        for i, run in enumerate(runs):
+            paths.append(f"run-{i}")
+            sort._write_run(paths[-1], run)
+        self.assertEqual([lines[0] for _, lines in sort._merged(paths)], ["a", "c", "d", "b", "e"])
+
+
+class SortedOutputTest(GeneratorTestCase):
+    def generate_sorted(self, sort_by_primary_key: bool, workers: int, fan_in: int = sort.MERGE_FAN_IN) -> dict[str, bytes]:
+        # batches of 4096 rows, so that every table is sorted from several runs
+        schema = DbSchema("sorted", SOURCE, 4, sort_by_primary_key=sort_by_primary_key)
+        try:
+            schema.configure_checkpoints(False, 1)
+            schema.configure_sorting(workers)
+            with mock.patch.object(sort, "MERGE_FAN_IN", fan_in):
+                schema.generate(True, "postgres")
+        finally:
+            schema.close()
+        output = self.read_tree("sorted")
+        output["sorted.sql"] = self.read("sorted.sql")
+        return output
+
+    def test_sorted_output_is_the_same_rows_in_key_order(self):
+        unsorted = self.generate_sorted(False, 1)
+        single = self.generate_sorted(True, 1)
+        for table, key in (("P.csv", "code"), ("C.csv", "k")):
+            with open(os.path.join("sorted", table), newline="") as f:
+                keys = [row[key] for row in csv.DictReader(f)]
+            self.assertEqual(keys, sorted(keys, key=int if key == "k" else None))
+            self.assertEqual(sorted(single[table].split(b"\r\n")), sorted(unsorted[table].split(b"\r\n")))
+        # the primary keys are created after the data
+        sql = single["sorted.sql"].decode()
+        self.assertNotIn("PRIMARY KEY", sql[:sql.index("INSERT")])
+        self.assertIn("PRIMARY KEY", sql[sql.rindex("INSERT"):])
+        # neither the workers nor the number of merge passes change the output
+        self.assertEqual(self.generate_sorted(True, 3), single)
+        self.assertEqual(self.generate_sorted(True, 1, fan_in=2), single)
+        self.assertEqual([name for name in os.listdir() if name.startswith(".sorted-")], [])
+
+
+if __name__ == "__main__":
+    unittest.main()
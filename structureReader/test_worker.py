@@ -0,0 +1,91 @@
+from structureReader.worker import RowCache, _read_frame, _write_frame, _HEADER
+from structureReader.testing import GeneratorTestCase, GENERATOR
+import io
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import unittest
+
+TABLES = [
+    {"name": "P", "rows": 2000, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "name", "type": "string", "generation": "namesurname", "length": 20}]},
+    {"name": "C", "rows": 5000, "attributes": [
+        {"name": "pid", "type": "foreign_key", "references": {"table": "P", "attribute": "id"}},
+        {"name": "x", "type": "real", "generation": "random", "step": 10}]},
+]
+
+
+def frame(message: dict) -> bytes:
+    payload = json.dumps(message).encode("utf-8")
+    return _HEADER.pack(len(payload)) + payload
+
+
+class FrameTest(unittest.TestCase):
+    def test_frames_round_trip_back_to_back(self):
+        channel = io.BytesIO()
+        messages = [{"args": ["-f", "schéma.json"], "id": 1}, {"exit": True}]
+        for message in messages:
+            _write_frame(channel, message)
+        channel.seek(0)
+        self.assertEqual([_read_frame(channel), _read_frame(channel), _read_frame(channel)], messages + [None])
+
+    def test_truncated_frames_end_the_stream(self):
+        whole = frame({"args": []})
+        for cut in (2, _HEADER.size, len(whole) - 1):
+            self.assertIsNone(_read_frame(io.BytesIO(whole[:cut])))
+
+
+class RowCacheTest(unittest.TestCase):
+    def test_least_recently_used_batches_are_dropped(self):
+        cache = RowCache(max_cells=20)
+        batch = {"a": list(range(5)), "b": list(range(5))}
+        cache.put("T", 0, 5, batch)
+        cache.put("T", 5, 10, batch)
+        self.assertIs(cache.get("T", 0, 5), batch)
+        cache.put("T", 10, 15, batch)
+        self.assertIsNone(cache.get("T", 5, 10))
+        self.assertIs(cache.get("T", 0, 5), batch)
+        self.assertIs(cache.get("T", 10, 15), batch)
+        # batches larger than the cache are not kept
+        cache.put("U", 0, 30, {"a": list(range(30))})
+        self.assertIsNone(cache.get("U", 0, 30))
+
+
+class WorkerTest(GeneratorTestCase):
+    def test_pipelined_requests_share_the_seed_and_match_a_command_line_run(self):
+        schema = self.write_schema("shop", TABLES)
+        requests = [
+            {"id": 1, "args": ["-f", schema, "--csv"]},
+            {"id": 2, "args": ["-f", schema, "--sql"]},
+            {"id": 3, "args": ["--no-such-option"]},
+            {"id": 4, "args": ["-f", "missing.json", "--csv"]},
+            {"exit": True},
+        ]
+        # every request is written before any reply is read, the worker reads the frames one by one
+        worker = subprocess.run([sys.executable, GENERATOR, "--worker"], input=b"".join(map(frame, requests)), capture_output=True, timeout=120)
+        self.assertEqual(worker.returncode, 0, worker.stderr)
+        replies = []
+        channel = io.BytesIO(worker.stdout)
+        while (reply := _read_frame(channel)) is not None:
+            replies.append(reply)
+        self.assertEqual([reply["id"] for reply in replies], [1, 2, 3, 4])
+        self.assertEqual([reply["exit_code"] for reply in replies[:2]], [0, 0])
+        self.assertEqual(replies[2]["exit_code"], 2)
+        self.assertIn("unrecognized arguments", replies[2]["error"])
+        self.assertEqual(replies[3]["exit_code"], 1)
+        seeds = [re.search(r"Using seed (\d+)", reply["output"])[1] for reply in replies[:2]]
+        self.assertEqual(seeds[0], seeds[1])
+        os.makedirs("worker")
+        shutil.move("shop", os.path.join("worker", "shop"))
+        shutil.move("shop.sql", os.path.join("worker", "shop.sql"))
+        self.generate("-f", schema, "--csv", "--sql", "--seed", seeds[0])
+        self.assertEqual(self.read_tree("shop"), self.read_tree(os.path.join("worker", "shop")))
+        self.assertEqual(self.read("shop.sql"), self.read(os.path.join("worker", "shop.sql")))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,79 @@
+from structureReader.testing import GeneratorTestCase
+import sqlite3
+import unittest
+
+TABLES = [
+    {"name": "customers", "rows": 300, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "name", "type": "string", "length": 12}]},
+    {"name": "orders", "rows": 1000, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+        {"name": "customer", "type": "foreign_key", "references": {"table": "customers", "attribute": "id"}},
+        {"name": "amount", "type": "real", "generation": "random", "step": 500}]},
+    {"name": "lines", "rows": 3000, "primary_keys": ["id"], "attributes": [
+        {"name": "id", "type": "integer", "generation": "decreasing", "start": 100000, "step": 1},
+        {"name": "order_id", "type": "foreign_key", "references": {"table": "orders", "attribute": "id"}},
+        {"name": "qty", "type": "integer", "generation": "random", "step": 10}]},
+    {"name": "events", "rows": 200, "attributes": [
+        {"name": "customer", "type": "foreign_key", "references": {"table": "customers", "attribute": "id"}},
+        {"name": "kind", "type": "string", "length": 5}]},
+]
+REFERENCES = [("orders", "customer", "customers"), ("lines", "order_id", "orders"), ("events", "customer", "customers")]
+
+
+def statements(path: str):
+    # the statements of a sql file, CREATE TABLE spans several lines
+    statement = ""
+    with open(path) as f:
+        for line in f:
+            statement += line
+            if sqlite3.complete_statement(statement):
+                yield statement.strip()
+                statement = ""
+
+
+class WorkloadReplayTest(GeneratorTestCase):
+    def replay(self, *options: str) -> sqlite3.Connection:
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "-s", "--seed", "8", "--workload", "4000", *options)
+        db = sqlite3.connect(":memory:")
+        # sqlite cannot add foreign keys to existing tables, they are checked after the replay.
+        # The tables are new, so nothing has to be dropped
+        for statement in statements("shop.sql"):
+            if not statement.startswith(("DROP TABLE", "ALTER TABLE")):
+                db.execute(statement)
+        for statement in statements("shop.workload.sql"):
+            changed = db.execute(statement).rowcount
+            # primary keys stay unique (sqlite enforces them) and updates and deletes hit an existing row
+            self.assertEqual(changed, 1, statement)
+        return db
+
+    def assert_no_dangling_references(self, db: sqlite3.Connection):
+        for table, column, parent in REFERENCES:
+            dangling = db.execute(f"SELECT COUNT(*) FROM {table} LEFT JOIN {parent} ON {table}.{column} = {parent}.id WHERE {parent}.id IS NULL").fetchone()[0]
+            self.assertEqual(dangling, 0, f"{table}.{column}")
+
+    def test_workload_replays_without_dangling_foreign_keys(self):
+        db = self.replay("--workload-mix", "insert=30,update=30,delete=40")
+        self.assert_no_dangling_references(db)
+        kinds = {statement.split()[0] for statement in statements("shop.workload.sql")}
+        self.assertEqual(kinds, {"INSERT", "UPDATE", "DELETE"})
+        # referenced tables only grow, the others lose rows as well
+        self.assertGreaterEqual(db.execute("SELECT COUNT(*) FROM customers").fetchone()[0], 300)
+        self.assertGreaterEqual(db.execute("SELECT COUNT(*) FROM orders").fetchone()[0], 1000)
+        self.assertGreater(db.execute("SELECT COUNT(*) FROM events").fetchone()[0], 200)
+
+    def test_skewed_workload_replays_without_dangling_foreign_keys(self):
+        self.assert_no_dangling_references(self.replay("--workload-skew", "0.9"))
+
+    def test_workload_is_deterministic_on_stdout_and_in_a_file(self):
+        schema = self.write_schema("shop", TABLES)
+        self.generate("-f", schema, "--seed", "8", "--workload", "500")
+        streamed = self.generate("-f", schema, "--seed", "8", "--workload", "500", "--workload-output", "-")
+        with open("shop.workload.sql", newline="") as f:
+            self.assertEqual(streamed.stdout, f.read())
+        self.assertIn("Workload of 500 operations was written to stdout", streamed.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,63 @@
+from structureReader.checkpoint import ResumableFile
+from structureReader.writer import WritePipeline
+from structureReader.testing import GeneratorTestCase
+import io
+import os
+import unittest
+
+
+class _FailingFile(io.BytesIO):
+    def write(self, data):
+        raise OSError("disk full")
+
+
+class WritePipelineTest(GeneratorTestCase):
+    def test_files_are_written_in_order_and_synced_before_their_callbacks(self):
+        synced = []
+        with WritePipeline(buffers=2) as pipeline:
+            files = [ResumableFile(f"out-{i}", pipeline=pipeline) for i in range(3)]
+            for block in range(50):
+                for i, out in enumerate(files):
+                    out.write_rows([f"{i}:{block}:{row}\n" for row in range(100)])
+                    if block % 10 == 9:
+                        offset = out.offset
+                        # the callback runs on the writer thread once the data before it is on disk
+                        out.durable(lambda i=i, offset=offset: synced.append((i, offset, os.path.getsize(f"out-{i}"))))
+            for out in files:
+                out.close()
+        for i, out in enumerate(files):
+            expected = "".join(f"{i}:{block}:{row}\n" for block in range(50) for row in range(100)).encode()
+            self.assertEqual(self.read(f"out-{i}"), expected)
+            self.assertEqual(out.offset, len(expected))
+            offsets = [offset for file, offset, _ in synced if file == i]
+            self.assertEqual(offsets, sorted(offsets))
+            self.assertEqual(len(offsets), 5)
+        self.assertTrue(all(size >= offset for _, offset, size in synced))
+
+    def test_write_errors_reach_the_generating_thread(self):
+        pipeline = WritePipeline(buffers=1)
+        writer = pipeline.writer(_FailingFile(), "failing")
+        writer.put(b"rows")
+        with self.assertRaises(OSError):
+            writer.drain()
+        with self.assertRaises(OSError):
+            writer.put(b"more rows")
+        writer.close()
+        with self.assertRaises(OSError):
+            pipeline.finish()
+
+    def test_background_writes_do_not_change_the_output(self):
+        schema = self.write_schema("bg", [
+            {"name": "A", "rows": 30000, "attributes": [
+                {"name": "id", "type": "integer", "generation": "increasing", "start": 1, "step": 1},
+                {"name": "s", "type": "string", "length": 16}]},
+            {"name": "B", "rows": 10000, "attributes": [
+                {"name": "w", "type": "string", "generation": "email", "length": 40}]}])
+        self.generate("-f", schema, "-c", "-s", "--seed", "6", "--write-buffers", "0")
+        synchronous = self.read_tree("bg"), self.read("bg.sql")
+        self.generate("-f", schema, "-c", "-s", "--seed", "6", "--write-buffers", "8")
+        self.assertEqual((self.read_tree("bg"), self.read("bg.sql")), synchronous)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,58 @@
+from typing import Any
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+REPOSITORY = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+GENERATOR = os.path.join(REPOSITORY, "mockDbGenerator.py")
+
+
+class GeneratorTestCase(unittest.TestCase):
+    # runs every test in a temporary working directory, where the generator reads data/ and writes its output
+    directory: str
+
+    def setUp(self):
+        self._cwd = os.getcwd()
+        self.directory = tempfile.mkdtemp(prefix="mockdb-test-")
+        try:
+            os.symlink(os.path.join(REPOSITORY, "data"), os.path.join(self.directory, "data"), target_is_directory=True)
+        except OSError:
+            # symbolic links need privileges on Windows
+            shutil.copytree(os.path.join(REPOSITORY, "data"), os.path.join(self.directory, "data"))
+        os.chdir(self.directory)
+
+    def tearDown(self):
+        os.chdir(self._cwd)
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+    def write_schema(self, name: str, tables: list[dict[str, Any]], **options: Any) -> str:
+        filename = f"{name}.json"
+        with open(filename, "w") as f:
+            json.dump({"tables": tables, **options}, f)
+        return filename
+
+    def generate(self, *args: str, check: bool = True) -> subprocess.CompletedProcess:
+        # runs the command line generator in a process of its own, as the profiler and the memory governor are global
+        result = subprocess.run([sys.executable, GENERATOR, *args], capture_output=True, text=True)
+        if check and result.returncode != 0:
+            self.fail(f"mockDbGenerator {' '.join(args)} exited with {result.returncode}\n{result.stdout}{result.stderr}")
+        return result
+
+    def read(self, path: str) -> bytes:
+        with open(path, "rb") as f:
+            return f.read()
+
+    def read_tree(self, directory: str) -> dict[str, bytes]:
+        # the files of a directory by relative path, hidden (checkpoint and spill) files excluded
+        tree = {}
+        for parent, directories, files in os.walk(directory):
+            directories[:] = [d for d in directories if not d.startswith(".")]
+            for file in files:
+                if not file.startswith("."):
+                    path = os.path.join(parent, file)
+                    tree[os.path.relpath(path, directory)] = self.read(path)
+        return tree
@@ -0,0 +1,142 @@
+from __future__ import annotations
+from collections import OrderedDict
+from contextlib import redirect_stdout, redirect_stderr
+from typing import Any, BinaryIO, Callable, TYPE_CHECKING
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR
+from structureReader.reader import parse_json_schema
+import io
+import json
+import os
+import struct
+import traceback
+
+if TYPE_CHECKING:
+    from structureReader.reader import DbSchema
+
+# cells (rows * columns) of generated batches kept between requests, about 60 bytes each (60 MB),
+# a request with a memory limit caps the cache further
+DEFAULT_CACHE_CELLS = 1 << 20
+# frames are a 4 byte big endian length followed by that many bytes of UTF-8 JSON
+_HEADER = struct.Struct(">I")
+
+
+class RowCache:
+    # generated batches of rows by (table, lo, hi), least recently used ones are dropped first
+    _max_cells: int
+    _cells: int
+
+    def __init__(self, max_cells: int):
+        self._max_cells = max_cells
+        self._cells = 0
+        self._batches: OrderedDict[tuple[str, int, int], dict[str, list[Any]]] = OrderedDict()
+
+    def get(self, table: str, lo: int, hi: int) -> dict[str, list[Any]] | None:
+        columns = self._batches.get((table, lo, hi))
+        if columns is not None:
+            self._batches.move_to_end((table, lo, hi))
+        return columns
+
+    def put(self, table: str, lo: int, hi: int, columns: dict[str, list[Any]]):
+        cells = (hi - lo) * len(columns)
+        # a memory limit caps the cache as well
+        max_cells = GOVERNOR.cache_cells(self._max_cells)
+        if cells > max_cells or (table, lo, hi) in self._batches:
+            return
+        self._batches[(table, lo, hi)] = columns
+        self._cells += cells
+        while self._cells > max_cells:
+            (_, old_lo, old_hi), old = self._batches.popitem(last=False)
+            self._cells -= (old_hi - old_lo) * len(old)
+
+    def clear(self):
+        self._batches.clear()
+        self._cells = 0
+
+
+class SchemaCache:
+    # the last schema of every file with its seed, key columns and row cache. A request without a seed
+    # reuses the seed of the cached schema while the file and options are unchanged, so the csv and sql
+    # exports of the same schema contain the same data
+    def __init__(self, max_cells: int = DEFAULT_CACHE_CELLS):
+        self._max_cells = max_cells
+        self._schemas: dict[str, tuple[tuple[str, float | None, bool | None], DbSchema]] = {}
+
+    def load(self, filename: str, seed: int | None, scale_factor: float | None, sort_by_primary_key: bool | None) -> DbSchema:
+        path = os.path.abspath(filename)
+        with open(path, "r") as file:
+            key = (file.read(), scale_factor, sort_by_primary_key)
+        cached = self._schemas.get(path)
+        if cached is not None:
+            cached_key, schema = cached
+            if cached_key == key and (seed is None or seed == schema.seed):
+                return schema
+            self._drop(path)
+        schema = parse_json_schema(filename, seed, scale_factor, sort_by_primary_key)
+        schema.configure_row_cache(RowCache(self._max_cells))
+        self._schemas[path] = (key, schema)
+        return schema
+
+    def _drop(self, path: str):
+        _, schema = self._schemas.pop(path)
+        schema.configure_row_cache(None)
+        schema.close()
+
+    def close(self):
+        for path in list(self._schemas):
+            self._drop(path)
+
+
+def _read_frame(channel: BinaryIO) -> dict[str, Any] | None:
+    header = channel.read(_HEADER.size)
+    if len(header) < _HEADER.size:
+        return None
+    (length,) = _HEADER.unpack(header)
+    payload = channel.read(length)
+    if len(payload) < length:
+        return None
+    return json.loads(payload.decode("utf-8"))
+
+
+def _write_frame(channel: BinaryIO, message: dict[str, Any]):
+    payload = json.dumps(message).encode("utf-8")
+    channel.write(_HEADER.pack(len(payload)))
+    channel.write(payload)
+    channel.flush()
+
+
+def serve(run: Callable[[list[str], SchemaCache], int | None], max_cells: int = DEFAULT_CACHE_CELLS):
+    # answers {"args": [...]} requests with {"exit_code", "output", "error"} until stdin is closed or
+    # {"exit": true} is received. Requests run the command line in this process, so modules, dictionaries,
+    # parsed schemas, their key columns and recently generated rows stay loaded between them
+    requests = os.fdopen(os.dup(0), "rb")
+    responses = os.fdopen(os.dup(1), "wb")
+    # anything else writing to stdout (or reading stdin), including child processes, must not touch the frames
+    os.dup2(2, 1)
+    devnull = os.open(os.devnull, os.O_RDONLY)
+    os.dup2(devnull, 0)
+    os.close(devnull)
+    schemas = SchemaCache(max_cells)
+    try:
+        while (request := _read_frame(requests)) is not None:
+            if request.get("exit"):
+                break
+            output = io.StringIO()
+            error = io.StringIO()
+            PROFILER.disable()
+            with redirect_stdout(output), redirect_stderr(error):
+                try:
+                    exit_code = run([str(arg) for arg in request.get("args", [])], schemas) or 0
+                except SystemExit as exc:
+                    exit_code = exc.code if isinstance(exc.code, int) else 1
+                except Exception:
+                    traceback.print_exc()
+                    exit_code = 1
+            _write_frame(responses, {
+                "id": request.get("id"),
+                "exit_code": exit_code,
+                "output": output.getvalue(),
+                "error": error.getvalue(),
+            })
+    finally:
+        schemas.close()
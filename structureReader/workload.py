@@ -0,0 +1,232 @@
+from __future__ import annotations
+from collections import OrderedDict
+from typing import Any, TextIO, TYPE_CHECKING
+from dataGenerators.generators import derive_seed
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR
+from structureReader.reader import CHUNK_ROWS, SQLDialect, sql_literal
+from structureReader.writer import RowLines
+import random
+
+if TYPE_CHECKING:
+    from structureReader.reader import DbSchema, DbTable, DbAttribute
+
+# operations decided and formatted at once
+WORKLOAD_BLOCK_OPS = 4096
+# deleted rows remembered individually per table, beyond this the oldest live row is deleted instead
+MAX_HOLES = 1 << 20
+# generated key chunks of inserted rows kept per table
+KEY_CACHE_CHUNKS = 64
+DEFAULT_MIX = {"insert": 40, "update": 50, "delete": 10}
+
+
+class InvalidWorkload(Exception):
+    def __init__(self, message: str):
+        super().__init__(message)
+
+
+def parse_mix(text: str) -> dict[str, float]:
+    # "insert=40,update=50,delete=10", missing operations get weight 0
+    mix = {kind: 0.0 for kind in DEFAULT_MIX}
+    for part in filter(None, (p.strip() for p in text.split(","))):
+        kind, _, weight = part.partition("=")
+        kind = kind.strip().lower()
+        if kind not in mix:
+            raise InvalidWorkload(f"Unknown operation '{kind}' in workload mix, valid operations are {', '.join(mix)}")
+        try:
+            mix[kind] = float(weight)
+        except ValueError:
+            raise InvalidWorkload(f"Invalid weight '{weight}' for '{kind}' in workload mix")
+        if mix[kind] < 0:
+            raise InvalidWorkload(f"Weight of '{kind}' in workload mix is negative")
+    if sum(mix.values()) <= 0:
+        raise InvalidWorkload(f"Workload mix '{text}' has no operations")
+    return mix
+
+
+class _LiveRows:
+    # rows of a table which exist at the current point of the stream, as row indexes:
+    # [low, high) minus a bounded set of deleted holes. Rows past the initial load are inserted ones
+    low: int
+    high: int
+    holes: set[int]
+
+    def __init__(self, rows: int):
+        self.low = 0
+        self.high = rows
+        self.holes = set()
+
+    @property
+    def count(self) -> int:
+        return self.high - self.low - len(self.holes)
+
+    def insert(self) -> int:
+        self.high += 1
+        return self.high - 1
+
+    def pick(self, rng: random.Random, skew: float) -> int:
+        # skewed towards the most recently inserted rows, skew 0 is uniform
+        span = self.high - self.low
+        for _ in range(16):
+            rank = int(span * rng.random() ** (1.0 / (1.0 - skew)))
+            index = self.high - 1 - min(rank, span - 1)
+            if index not in self.holes:
+                return index
+        index = self.high - 1
+        while index in self.holes:
+            index -= 1
+        return index
+
+    def delete(self, index: int) -> int:
+        # returns the row actually deleted
+        if index != self.low and len(self.holes) >= MAX_HOLES:
+            index = self.low
+        if index == self.low:
+            self.low += 1
+            while self.low in self.holes:
+                self.holes.remove(self.low)
+                self.low += 1
+        else:
+            self.holes.add(index)
+        return index
+
+
+class _TableStream:
+    table: DbTable
+    live: _LiveRows
+    updatable: list[DbAttribute]
+    deletable: bool
+    updates: int
+
+    def __init__(self, table: DbTable, referenced: bool):
+        self.table = table
+        self.live = _LiveRows(table._quantity)
+        keys = set(attribute._name for attribute in table._keys)
+        # neither keys nor columns other tables point to can change
+        self.updatable = [
+            attribute for name, attribute in table._attributes.items()
+            if name not in keys and attribute not in table._referenced
+        ]
+        # rows of referenced tables are never deleted, so foreign keys always find their row
+        self.deletable = len(table._keys) > 0 and not referenced
+        self.updates = 0
+        self._key_chunks: OrderedDict[tuple[str, int], list[Any]] = OrderedDict()
+
+    def can_update(self) -> bool:
+        return len(self.table._keys) > 0 and len(self.updatable) > 0 and self.table._quantity > 0 and self.live.count > 0
+
+    def can_delete(self) -> bool:
+        return self.deletable and self.live.count > 0
+
+    def key_value(self, attribute: DbAttribute, index: int) -> Any:
+        if index < self.table._quantity:
+            # rows of the initial load come from the (spilled) key column
+            return self.table.key_column(attribute)[index]
+        chunk = index // CHUNK_ROWS
+        cache_key = (attribute._name, chunk)
+        values = self._key_chunks.get(cache_key)
+        if values is None:
+            values = self.table.generate_column(attribute, chunk * CHUNK_ROWS, (chunk + 1) * CHUNK_ROWS)
+            self._key_chunks[cache_key] = values
+            if len(self._key_chunks) > max(1, GOVERNOR.cache_cells(KEY_CACHE_CHUNKS * CHUNK_ROWS) // CHUNK_ROWS):
+                self._key_chunks.popitem(last=False)
+        else:
+            self._key_chunks.move_to_end(cache_key)
+        return values[index - chunk * CHUNK_ROWS]
+
+    def where(self, index: int, dialect: SQLDialect) -> str:
+        return " AND ".join(
+            f"{key._name} = {sql_literal(key.type, self.key_value(key, index), dialect)}" for key in self.table._keys
+        )
+
+
+def _donor_rows(table: DbTable, start: int, count: int) -> dict[str, list[Any]]:
+    # updates take their new values from the initial rows, cycling through them
+    columns: dict[str, list[Any]] = {name: [] for name in table._attributes}
+    position = start % table._quantity
+    while count > 0:
+        hi = min(table._quantity, position + count)
+        for name, values in table.generate_rows(position, hi, spill=False).items():
+            columns[name].extend(values)
+        count -= hi - position
+        position = 0
+    return columns
+
+
+def generate_workload(schema: DbSchema, dialect: str, operations: int, mix: dict[str, float], skew: float, out: TextIO):
+    # deterministic stream of inserts, updates and deletes following the initial load of the same schema and seed
+    sql_dialect = SQLDialect.POSTGRES if dialect == "postgres" else SQLDialect.ORACLE
+    if not 0 <= skew < 1:
+        raise InvalidWorkload(f"Workload skew must be in [0, 1), {skew} was given")
+    referenced = {attribute for table in schema._tables for attribute in table._referenced}
+    streams = [
+        _TableStream(table, any(attribute in referenced for attribute in table._attributes.values()))
+        for table in schema.selected_tables
+    ]
+    if not streams:
+        raise InvalidWorkload(f"Schema {schema._name} has no tables")
+    weights = [max(stream.table._quantity, 1) for stream in streams]
+    kinds = list(mix)
+    kind_weights = [mix[kind] for kind in kinds]
+    rng = random.Random(derive_seed(schema.seed, "workload"))
+    done = 0
+    while done < operations:
+        block = min(WORKLOAD_BLOCK_OPS, operations - done)
+        with PROFILER.stage("workload") as scope:
+            ops: list[tuple[str, _TableStream, int, int]] = []
+            inserts: dict[int, list[int]] = {}
+            donors: dict[int, list[int]] = {}
+            for _ in range(block):
+                kind = rng.choices(kinds, kind_weights)[0]
+                stream = rng.choices(streams, weights)[0]
+                if kind == "delete" and not stream.can_delete():
+                    candidates = [s for s in streams if s.can_delete()]
+                    stream = candidates[rng.randrange(len(candidates))] if candidates else stream
+                    kind = "delete" if candidates else "update"
+                if kind == "update" and not stream.can_update():
+                    candidates = [s for s in streams if s.can_update()]
+                    stream = candidates[rng.randrange(len(candidates))] if candidates else stream
+                    kind = "update" if candidates else "insert"
+                if kind == "insert":
+                    index = stream.live.insert()
+                    inserts.setdefault(id(stream), []).append(index)
+                    ops.append((kind, stream, index, 0))
+                elif kind == "update":
+                    index = stream.live.pick(rng, skew)
+                    donors.setdefault(id(stream), []).append(stream.updates)
+                    ops.append((kind, stream, index, stream.updates))
+                    stream.updates += 1
+                else:
+                    index = stream.live.delete(stream.live.pick(rng, skew))
+                    ops.append((kind, stream, index, 0))
+            # values are generated per table for the whole block, inserted rows are contiguous
+            insert_lines: dict[int, list[str]] = {}
+            for stream in streams:
+                if indexes := inserts.get(id(stream)):
+                    lines = RowLines()
+                    lo, hi = indexes[0], indexes[-1] + 1
+                    stream.table._format_insertion_sql(lines, stream.table.generate_rows(lo, hi, spill=False), hi - lo, sql_dialect)  # type: ignore
+                    insert_lines[id(stream)] = lines
+            donor_columns = {
+                id(stream): _donor_rows(stream.table, donors[id(stream)][0], len(donors[id(stream)]))
+                for stream in streams if id(stream) in donors
+            }
+            text = []
+            for kind, stream, index, update in ops:
+                table = stream.table
+                if kind == "insert":
+                    text.append(insert_lines[id(stream)][index - inserts[id(stream)][0]])
+                elif kind == "update":
+                    columns = donor_columns[id(stream)]
+                    position = update - donors[id(stream)][0]
+                    assignments = ", ".join(
+                        f"{attribute._name} = {sql_literal(attribute.type, columns[attribute._name][position], sql_dialect)}"
+                        for attribute in stream.updatable
+                    )
+                    text.append(f"UPDATE {table._name} SET {assignments} WHERE {stream.where(index, sql_dialect)};\n")
+                else:
+                    text.append(f"DELETE FROM {table._name} WHERE {stream.where(index, sql_dialect)};\n")
+            chunk = "".join(text)
+            out.write(chunk)
+            scope.add(rows=block, bytes=len(chunk))
+        done += block
@@ -0,0 +1,128 @@
+from __future__ import annotations
+from typing import Any, BinaryIO, Callable
+from instrumentation.profiler import PROFILER
+from instrumentation.memory import GOVERNOR
+import os
+import queue
+import threading
+
+# encoded batches queued per file before the generating thread has to wait for the disk
+DEFAULT_WRITE_BUFFERS = 4
+
+_CLOSE = object()
+
+
+class RowLines(list):
+    # formatted output kept as one string per row (the csv writer and the insertion formatter write
+    # exactly once per row), so that it can only be cut between rows
+    def write(self, text: str):
+        self.append(text)
+
+
+class _FileWriter:
+    # writes the buffers handed over by the generating thread, in order, on its own thread.
+    # The buffers are the encoded bytes objects themselves, nothing is copied. Syncs run their
+    # callback once everything queued before them is on disk
+    def __init__(self, file: BinaryIO, name: str, buffers: int):
+        self._file = file
+        self._name = name
+        self._queue: queue.Queue[Any] = queue.Queue(maxsize=max(1, buffers))
+        self._error: BaseException | None = None
+        self._thread = threading.Thread(target=self._run, name=f"writer-{name}", daemon=True)
+        self._thread.start()
+
+    def _run(self):
+        while True:
+            item = self._queue.get()
+            try:
+                if item is _CLOSE:
+                    self._file.close()
+                    return
+                if self._error is not None:
+                    # keep draining so that the generating thread never blocks on a dead writer
+                    continue
+                if isinstance(item, tuple):
+                    with PROFILER.stage("disk_sync", self._name):
+                        self._file.flush()
+                        os.fsync(self._file.fileno())
+                        callback = item[0]
+                        if callback is not None:
+                            callback()
+                else:
+                    with PROFILER.stage("disk_write", self._name) as scope:
+                        self._file.write(item)
+                        scope.add(bytes=len(item))
+            except BaseException as exc:
+                self._error = exc
+            finally:
+                if isinstance(item, bytes):
+                    GOVERNOR.release(len(item))
+                self._queue.task_done()
+
+    def _check(self):
+        if self._error is not None:
+            raise self._error
+
+    def put(self, data: bytes):
+        self._check()
+        # with a memory limit all the writers together only hold so much
+        GOVERNOR.reserve(len(data))
+        self._queue.put(data)
+
+    def sync(self, callback: Callable[[], None] | None):
+        self._check()
+        self._queue.put((callback,))
+
+    def drain(self):
+        self._queue.join()
+        self._check()
+
+    def close(self):
+        self._queue.put(_CLOSE)
+
+    def join(self):
+        self._thread.join()
+        self._check()
+
+
+class WritePipeline:
+    # keeps the writers of the files closed by the generating thread running until everything is written,
+    # so the next table is generated while the previous one is still going to disk
+    buffers: int
+
+    def __init__(self, buffers: int = DEFAULT_WRITE_BUFFERS):
+        self.buffers = buffers
+        self._writers: list[_FileWriter] = []
+
+    def writer(self, file: BinaryIO, name: str) -> _FileWriter | None:
+        if self.buffers <= 0:
+            return None
+        writer = _FileWriter(file, name, self.buffers)
+        self._writers.append(writer)
+        return writer
+
+    def finish(self):
+        # waits for every file and raises the first write error
+        writers, self._writers = self._writers, []
+        errors = []
+        for writer in writers:
+            try:
+                writer.join()
+            except BaseException as exc:
+                errors.append(exc)
+        if errors:
+            raise errors[0]
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        if exc[0] is None:
+            self.finish()
+        else:
+            # the original error is the interesting one
+            try:
+                self.finish()
+            except BaseException:
+                pass
+        return False